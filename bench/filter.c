@@ -0,0 +1,187 @@
+// Copyright 2009-2022 Mitchell.
+// Headless benchmark of the filteredlist filter engine.
+// Generates synthetic corpora of file paths and symbols with 10^3 up to a maximum number of rows,
+// replays typing sequences against them using the same filter engine gtdialog's filteredlist
+// dialogs use, and writes one JSON object per corpus, size, and sequence to stdout.
+// Usage: bench/filter [max_rows]
+
+#define _DEFAULT_SOURCE 1 // for clock_gettime() in strict C99 mode
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+/** The number of allocations made so far. */
+static long allocations;
+
+/** Allocation functions that count allocations, including those made on worker threads. */
+static void *counted_malloc(size_t size) {
+  return (__atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED), malloc(size));
+}
+static void *counted_calloc(size_t n, size_t size) {
+  return (__atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED), calloc(n, size));
+}
+static void *counted_realloc(void *p, size_t size) {
+  return (__atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED), realloc(p, size));
+}
+#define malloc counted_malloc
+#define calloc counted_calloc
+#define realloc counted_realloc
+
+// Compile the filter engine here so its allocations are counted too.
+#include "../filter.c"
+
+/** The number of times each typing sequence is replayed per corpus size. */
+#define REPEATS 5
+
+/** A typing sequence to replay. */
+typedef struct {
+  /** The sequence's name. */
+  const char *name;
+  /** The characters typed, in lowercase. '\b' is a backspace. */
+  const char *keys;
+  /** Whether or not to match fuzzily. */
+  int fuzzy;
+} Sequence;
+
+/** A synthetic corpus of filteredlist rows. */
+typedef struct {
+  /** The corpus's name. */
+  const char *name;
+  /** Function that writes the corpus's given row to a buffer. */
+  void (*row)(char *buf, size_t size, unsigned int seed);
+  /** The typing sequences to replay, terminated by one with a `NULL` name. */
+  Sequence sequences[5];
+} Corpus;
+
+// Words that synthetic rows are made of.
+static const char *dirs[] = {"src", "lib", "include", "test", "docs", "core", "ui", "net", "util",
+  "io", "gfx", "audio", "build", "tools", "vendor"};
+static const char *nouns[] = {"main", "config", "parser", "buffer", "window", "socket", "render",
+  "widget", "string", "thread", "event", "cache", "filter", "layout", "stream", "token"};
+static const char *verbs[] = {
+  "get", "set", "update", "create", "destroy", "find", "parse", "render", "handle", "load"};
+static const char *exts[] = {".c", ".h", ".cpp", ".py", ".lua", ".md"};
+#define pick(words, r) words[(r) % (sizeof(words) / sizeof(*words))]
+
+/** Returns the next number from the given xorshift random number generator state. */
+static unsigned int next_random(unsigned int *state) {
+  *state ^= *state << 13, *state ^= *state >> 17, *state ^= *state << 5;
+  return *state;
+}
+
+/** Writes a file path like "src/ui/widget_1234.c" for the given row. */
+static void path_row(char *buf, size_t size, unsigned int seed) {
+  unsigned int r = seed * 2654435761u + 1, depth = 1 + next_random(&r) % 4;
+  size_t len = 0;
+  for (unsigned int i = 0; i < depth; i++)
+    len += snprintf(buf + len, size - len, "%s/", pick(dirs, next_random(&r)));
+  snprintf(buf + len, size - len, "%s_%u%s", pick(nouns, next_random(&r)), seed,
+    pick(exts, next_random(&r)));
+}
+
+/** Writes a symbol like "ui::WidgetCache::findToken42" for the given row. */
+static void symbol_row(char *buf, size_t size, unsigned int seed) {
+  unsigned int r = seed * 2654435761u + 1;
+  const char *noun1 = pick(nouns, next_random(&r)), *noun2 = pick(nouns, next_random(&r)),
+             *noun3 = pick(nouns, next_random(&r));
+  snprintf(buf, size, "%s::%c%s%c%s::%s%c%s%u", pick(dirs, next_random(&r)), toupper(*noun1),
+    noun1 + 1, toupper(*noun2), noun2 + 1, pick(verbs, next_random(&r)), toupper(*noun3),
+    noun3 + 1, seed);
+}
+
+static const Corpus corpora[] = {
+  {"paths", path_row,
+    {{"typing", "src/ui/widget", FALSE}, {"tokens", "net sock .c", FALSE},
+      {"correction", "rendr\b\ber_1", FALSE}, {"fuzzy", "srcwdg", TRUE}, {NULL, NULL, FALSE}}},
+  {"symbols", symbol_row,
+    {{"typing", "findtoken", FALSE}, {"tokens", "widget ::get", FALSE},
+      {"correction", "strem\b\beam", FALSE}, {"fuzzy", "uicache", TRUE}, {NULL, NULL, FALSE}}}};
+
+/** Returns the current time of a monotonic clock in microseconds. */
+static int64_t monotonic_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** Compares two latencies for qsort(). */
+static int compare_latencies(const void *a, const void *b) {
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+/** Returns the given percentile of the given sorted latencies, using the nearest-rank method. */
+static int64_t percentile(const int64_t *latencies, int n, int p) {
+  int k = ((long long)p * n + 99) / 100;
+  return latencies[k > 0 ? k - 1 : 0];
+}
+
+/**
+ * Replays the given typing sequence against the given filter's rows and writes the results.
+ * Each replay starts with an empty cache of query results.
+ */
+static void replay(Filter *filter, const char *corpus, const Sequence *sequence, double index_ms) {
+  int nkeys = strlen(sequence->keys), nmatches = 0, n = 0, num_rows = filter->num_rows;
+  int64_t *latencies = malloc(sizeof(int64_t) * nkeys * REPEATS), total = 0;
+  long nallocations = 0;
+  char query[64];
+  filter->matcher.fuzzy = sequence->fuzzy;
+  for (int repeat = 0; repeat < REPEATS; repeat++) {
+    size_t len = 0;
+    free_filter_cache(&filter->cache);
+    for (const char *key = sequence->keys; *key; key++) {
+      if (*key == '\b')
+        len -= len > 0;
+      else if (len < sizeof(query) - 1)
+        query[len++] = *key;
+      query[len] = '\0';
+      long allocated = allocations;
+      int64_t start = monotonic_time();
+      // Filter the same way filteredlist dialogs do on each keystroke.
+      filter_set_query(filter, query), filter_matches(filter, &nmatches);
+      int64_t latency = monotonic_time() - start;
+      nallocations += allocations - allocated, total += latency, latencies[n++] = latency;
+    }
+  }
+  qsort(latencies, n, sizeof(int64_t), compare_latencies);
+  printf("{\"corpus\": \"%s\", \"rows\": %d, \"sequence\": \"%s\", \"fuzzy\": %s, "
+         "\"keystrokes\": %d, \"matches\": %d, \"rows_per_sec\": %.0f, "
+         "\"latency_us\": {\"p50\": %lld, \"p95\": %lld, \"p99\": %lld, \"max\": %lld}, "
+         "\"allocations_per_keystroke\": %.2f, \"index_ms\": %.3f}\n",
+    corpus, num_rows, sequence->name, sequence->fuzzy ? "true" : "false", n / REPEATS, nmatches,
+    total > 0 ? (double)num_rows * n / (total / 1e6) : 0.0,
+    (long long)percentile(latencies, n, 50), (long long)percentile(latencies, n, 95),
+    (long long)percentile(latencies, n, 99), (long long)latencies[n - 1],
+    (double)nallocations / n, index_ms);
+  fflush(stdout);
+  free(latencies);
+}
+
+int main(int argc, char *argv[]) {
+  int max_rows = argc > 1 ? atoi(argv[1]) : 10000000;
+  char row[256];
+  for (size_t i = 0; i < sizeof(corpora) / sizeof(*corpora); i++) {
+    Filter filter;
+    filter_init(&filter, 1, 1, FILTER_SUBSTRING);
+    for (int size = 1000; size <= max_rows; size *= 10) {
+      for (int num_rows = filter.num_rows; num_rows < size; num_rows++)
+        corpora[i].row(row, sizeof(row), num_rows), filter_add_item(&filter, row, strlen(row));
+      filter_add_rows(&filter, FALSE);
+      // Build the trigram index large lists get, and wait for it like a user would.
+      TrigramIndex *index = &filter.index;
+      free_trigram_index(index), memset(index, 0, sizeof(TrigramIndex)); // index all rows again
+      int64_t start = monotonic_time();
+      filter_index(&filter);
+      while (index->started && !atomic_get(&index->ready)) usleep(1000);
+      double index_ms = index->started ? (monotonic_time() - start) / 1000.0 : 0;
+      for (const Sequence *sequence = corpora[i].sequences; sequence->name; sequence++)
+        replay(&filter, corpora[i].name, sequence, index_ms);
+    }
+    filter_free(&filter);
+  }
+  return 0;
+}
@@ -0,0 +1,75 @@
+#!/bin/sh
+# Copyright 2009-2022 Mitchell.
+# Measures how long gtdialog takes to draw the first frame of each dialog type and reports the
+# 50th, 95th, and 99th percentiles in milliseconds.
+# Usage: bench/startup.sh [gtdialog] [runs]
+# GTK dialogs are shown on a virtual X server (Xvfb) unless $DISPLAY is set, or on GDK's Broadway
+# backend if $GDK_BACKEND is "broadway". Curses dialogs (when *gtdialog* is a curses build) are
+# shown in a pseudo-terminal created by script(1).
+
+gtdialog=$(realpath "${1:-./gtdialog}")
+runs=${2:-100}
+case $gtdialog in *curses*) curses=1 ;; esac
+
+tmp=$(mktemp -d)
+trap 'exec 3>&-; [ -n "$server" ] && kill $server; rm -rf "$tmp"' EXIT
+if [ -z "$curses" ] && [ -z "$DISPLAY" ]; then
+  if [ "$GDK_BACKEND" = broadway ]; then
+    broadwayd :5 >/dev/null 2>&1 & server=$! # GTK 3
+    export BROADWAY_DISPLAY=:5
+  else
+    Xvfb :99 -nolisten tcp >/dev/null 2>&1 & server=$!
+    export DISPLAY=:99
+  fi
+  sleep 1
+fi
+# Dialogs read from a FIFO that is never written to so stdin stays open, as a progressbar needs.
+mkfifo "$tmp/stdin" && exec 3<>"$tmp/stdin"
+
+# Shows the given dialog until it draws its first frame and prints the milliseconds that took.
+first_frame() {
+  rm -f "$tmp/profile"
+  if [ -n "$curses" ]; then
+    script -qc "$gtdialog $* --profile 2>$tmp/profile" /dev/null <"$tmp/stdin" >/dev/null 2>&1 &
+  else
+    "$gtdialog" "$@" --profile 2>"$tmp/profile" <"$tmp/stdin" >/dev/null &
+  fi
+  pid=$!
+  i=0
+  until grep -q ' draw ' "$tmp/profile" 2>/dev/null || [ $i -ge 500 ]; do
+    sleep 0.01; i=$((i + 1))
+  done
+  # Killing script(1) closes its pseudo-terminal, which hangs up the dialog.
+  kill ${curses:+-KILL} $pid 2>/dev/null; wait $pid 2>/dev/null
+  awk '$3 == "draw" { print $6 }' "$tmp/profile"
+}
+
+# Prints the given percentiles of the numbers read from stdin, using the nearest-rank method.
+percentiles() {
+  sort -n | awk -v ps="$*" '{ x[NR] = $1 } END {
+    n = split(ps, p, " ")
+    for (i = 1; i <= n; i++) {
+      k = int(p[i] * NR / 100); if (k < p[i] * NR / 100) k++; if (k < 1) k = 1
+      printf "  p%d %9.3f", p[i], x[k]
+    }
+    print ""
+  }'
+}
+
+while read -r type args; do
+  [ -n "$curses" ] && case $type in colorselect | fontselect) continue ;; esac
+  n=0
+  while [ $n -lt $runs ]; do first_frame $type $args; n=$((n + 1)); done >"$tmp/times"
+  [ -s "$tmp/times" ] || { printf '%-16s no frames drawn\n' $type; continue; }
+  printf '%-16s' $type; percentiles 50 95 99 <"$tmp/times"
+done <<'DIALOGS'
+msgbox --text Message --button1 Ok
+inputbox --informative-text Input --text Text --button1 Ok
+textbox --text Text --button1 Ok
+progressbar --percent 50
+dropdown --items One Two Three
+filteredlist --columns Item --items One Two Three
+optionselect --items One Two Three --button1 Ok
+colorselect --color #FF0000
+fontselect --font-name Monospace
+DIALOGS
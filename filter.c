@@ -0,0 +1,941 @@
+/**
+ * The filteredlist filter engine shared by gtDialog's GTK and curses dialogs.
+ *
+ * The MIT License
+ *
+ * Copyright (c) 2009-2022 Mitchell
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#if !_WIN32
+#define _DEFAULT_SOURCE 1 // for mmap() and sysconf() in strict C99 mode
+#endif
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if !_WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+#include <immintrin.h>
+#define HAVE_SIMD 1
+#endif
+
+#include "filter.h"
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+#define copy(s) strcpy(malloc(strlen(s) + 1), s)
+
+char *filter_reader_space(ItemReader *reader) {
+  size_t needed = reader->len + ITEMS_BATCH + 1; // leave room for a trailing '\0'
+  if (needed > reader->size) {
+    reader->size = (2 * reader->size > needed) ? 2 * reader->size : needed;
+    reader->buf = realloc(reader->buf, reader->size);
+  }
+  return reader->buf + reader->len;
+}
+
+void filter_read(ItemReader *reader, size_t n, int eof) {
+  char *p = reader->buf, *end = reader->buf + reader->len + n, *q;
+  while ((q = memchr(p, reader->delim, end - p))) {
+    if (reader->delim == '\n' && q > p && *(q - 1) == '\r') *(q - 1) = '\0'; // chomp '\r'
+    *q = '\0', reader->add_item(p, reader->userdata), p = q + 1;
+  }
+  if (eof && p < end) *end = '\0', reader->add_item(p, reader->userdata), p = end;
+  reader->len = end - p;
+  if (reader->len > 0) memmove(reader->buf, p, reader->len);
+}
+
+/**
+ * Marks the end of the next item in the given list of items.
+ * @param items The list of items.
+ * @param offset The offset of the item's delimiter.
+ */
+static void end_item(Items *items, size_t offset) {
+  if (items->len + 2 > items->offsets_size) {
+    items->offsets_size = (items->offsets_size > 0) ? 2 * items->offsets_size : 1024;
+    items->offsets = realloc(items->offsets, sizeof(size_t) * items->offsets_size);
+    if (items->len == 0) items->offsets[0] = 0;
+  }
+  items->offsets[++items->len] = offset + 1;
+}
+
+/**
+ * Appends a copy of the given item to the given list of owned items.
+ * @param items The list of items.
+ * @param item The item to append.
+ * @param len The length of *item*.
+ */
+static void add_item(Items *items, const char *item, size_t len) {
+  size_t needed = items->size + len + 1;
+  if (needed > items->capacity) {
+    items->capacity = (2 * items->capacity > needed) ? 2 * items->capacity : needed;
+    items->data = realloc(items->data, items->capacity);
+  }
+  memcpy(items->data + items->size, item, len), items->data[items->size + len] = '\0';
+  items->size += len + 1;
+  end_item(items, items->size - 1);
+}
+
+/**
+ * Memory-maps the contents of the given file descriptor as the given empty list of items, and
+ * indexes them.
+ * @param items The list of items.
+ * @param fd The file descriptor to map. It may be closed afterwards.
+ * @param delim The character that delimits items.
+ * @return TRUE on success, or FALSE if the file descriptor cannot be mapped (e.g. it is a pipe).
+ */
+static int map_items(Items *items, int fd, char delim) {
+#if !_WIN32
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) return FALSE;
+  if (st.st_size > 0) {
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) return FALSE;
+    items->data = data, items->size = st.st_size, items->mapped = TRUE;
+  }
+  items->chomp_cr = delim == '\n'; // CRLF files give the same items as when streamed
+  const char *p = items->data, *end = items->data + items->size, *q;
+  for (; p < end; p = q + 1) {
+    if (!(q = memchr(p, delim, end - p))) q = end; // last item may not be delimited
+    end_item(items, q - items->data);
+  }
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+/** Frees the given list of items. */
+static void free_items(Items *items) {
+#if !_WIN32
+  if (items->mapped) munmap(items->data, items->size), items->data = NULL;
+#endif
+  free(items->data), free(items->offsets);
+}
+
+/**
+ * Loads the filteredlist's initial items into the given empty list of items.
+ * If the given file descriptor is to be and can be memory-mapped, its items are used in place of
+ * the given items. Otherwise the given items are copied, and the file descriptor is the one to
+ * stream the remaining items from.
+ * @param table The list of items to load into.
+ * @param items The items given on the command line.
+ * @param len The number of items given on the command line.
+ * @param fd The file descriptor to load items from, or -1.
+ * @param map Whether or not to try memory-mapping the file descriptor.
+ * @param delim The character that delimits items read from the file descriptor.
+ * @return file descriptor to stream items from, or -1 if there is none or it was mapped
+ */
+static int load_items(Items *table, const char **items, int len, int fd, int map, char delim) {
+  if (fd >= 0 && map && map_items(table, fd, delim)) return -1;
+  for (int i = 0; i < len; i++) add_item(table, items[i], strlen(items[i]));
+  return fd;
+}
+
+/** Returns the bit that represents the given character in a key's character set. */
+#define char_bit(c) ((uint64_t)1 << ((unsigned char)(c) % 64))
+/** Returns the '\0'-terminated key of row *i* in the given search keys. */
+#define key_text(keys, i) item_text(&(keys)->text, i)
+
+/**
+ * Appends the case-folded form of the given text to the given list of search keys.
+ * Keys are folded once when rows are added so filtering does not have to.
+ * @param keys The list of search keys.
+ * @param s The text to fold. It need not be '\0'-terminated.
+ * @param len The length of *s*.
+ */
+static void add_key(Keys *keys, const char *s, size_t len) {
+  Items *text = &keys->text;
+#if GTK
+  char *lower = NULL;
+  for (size_t i = 0; i < len; i++)
+    if (s[i] & 0x80) {
+      s = lower = g_utf8_strdown(s, len), len = strlen(lower);
+      break;
+    }
+  add_item(text, s, len), g_free(lower);
+#else
+  add_item(text, s, len);
+#endif
+  char *key = item_text(text, text->len - 1);
+  uint64_t mask = 0;
+  for (size_t i = 0; i < len; i++)
+    key[i] = tolower((unsigned char)key[i]), mask |= char_bit(key[i]);
+  if (text->len > keys->masks_size) {
+    keys->masks_size = (keys->masks_size > 0) ? 2 * keys->masks_size : 1024;
+    keys->masks = realloc(keys->masks, sizeof(uint64_t) * keys->masks_size);
+  }
+  keys->masks[text->len - 1] = mask;
+}
+
+/** Frees the given search keys. */
+static void free_keys(Keys *keys) { free_items(&keys->text), free(keys->masks); }
+
+/** The minimum number of filteredlist rows worth building a trigram index for. */
+#define TRIGRAM_INDEX_MIN 500000
+/** The number of bits in a trigram's bucket number. */
+#define TRIGRAM_BITS 18
+/** The number of hash buckets trigrams are indexed in. Trigrams that collide share a bucket. */
+#define TRIGRAM_BUCKETS (1 << TRIGRAM_BITS)
+/** The number of rows indexed between checks for whether or not indexing was cancelled. */
+#define TRIGRAM_CHUNK 65536
+
+#if GTK
+#define atomic_get(p) g_atomic_int_get(p)
+#define atomic_set(p, v) g_atomic_int_set(p, v)
+#else
+#define atomic_get(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define atomic_set(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#endif
+
+/** Returns the index bucket of the trigram at the start of the given text. */
+#define trigram_bucket(s) \
+  ((((unsigned char)(s)[0] << 16 | (unsigned char)(s)[1] << 8 | (unsigned char)(s)[2]) * \
+     2654435761u & 0xffffffffu) >> (32 - TRIGRAM_BITS))
+
+/**
+ * Counts or lists the rows each bucket of the given trigram index has, depending on whether
+ * the index's postings have been allocated yet.
+ * A row is counted or listed only once per bucket, no matter how many of its trigrams fall in it.
+ * @param index The trigram index.
+ * @param counts The list of bucket counts to increment, or the list of next offsets to store rows
+ *   at in each bucket.
+ * @return `FALSE` if indexing was cancelled, `TRUE` otherwise
+ */
+static int scan_trigrams(TrigramIndex *index, size_t *counts) {
+  int *last = malloc(sizeof(int) * TRIGRAM_BUCKETS);
+  for (int i = 0; i < TRIGRAM_BUCKETS; i++) last[i] = -1;
+  for (int row = 0; row < index->len; row++) {
+    if (row % TRIGRAM_CHUNK == 0 && atomic_get(&index->cancelled)) return (free(last), FALSE);
+    const char *key = key_text(index->keys, row);
+    for (size_t i = 0, n = item_len(&index->keys->text, row); i + 2 < n; i++) {
+      unsigned int bucket = trigram_bucket(key + i);
+      if (last[bucket] == row) continue;
+      last[bucket] = row;
+      if (index->postings)
+        index->postings[counts[bucket]++] = row;
+      else
+        counts[bucket]++;
+    }
+  }
+  return (free(last), TRUE);
+}
+
+/** Builds the given trigram index and marks it as ready, unless it is cancelled. */
+static void build_trigram_index(TrigramIndex *index) {
+  size_t *counts = calloc(TRIGRAM_BUCKETS + 1, sizeof(size_t));
+  if (scan_trigrams(index, counts + 1)) {
+    for (int i = 1; i <= TRIGRAM_BUCKETS; i++) counts[i] += counts[i - 1];
+    index->offsets = memcpy(malloc(sizeof(size_t) * (TRIGRAM_BUCKETS + 1)), counts,
+      sizeof(size_t) * (TRIGRAM_BUCKETS + 1));
+    index->postings = malloc(sizeof(int) * (counts[TRIGRAM_BUCKETS] + 1));
+    if (scan_trigrams(index, counts)) atomic_set(&index->ready, TRUE);
+  }
+  free(counts);
+}
+
+#if (GTK || !_WIN32)
+/** Function for building a trigram index on a separate thread. */
+static void *trigram_index_thread(void *data) {
+  return (build_trigram_index((TrigramIndex *)data), NULL);
+}
+#endif
+
+/**
+ * Starts indexing the trigrams of the given search keys in the background if there are enough
+ * of them to be worth it.
+ * The keys must not change while they are being indexed.
+ * @param index The trigram index to build.
+ * @param keys The search keys to index.
+ * @param len The number of keys to index.
+ */
+static void start_trigram_index(TrigramIndex *index, const Keys *keys, int len) {
+  if (index->started || len < TRIGRAM_INDEX_MIN) return;
+  index->keys = keys, index->len = len, index->started = TRUE;
+#if GTK
+  index->thread = g_thread_new("trigram-index", trigram_index_thread, index);
+#elif !_WIN32
+  if (pthread_create(&index->thread, NULL, trigram_index_thread, index) != 0)
+    index->started = FALSE; // filter without an index
+#else
+  build_trigram_index(index);
+#endif
+}
+
+/**
+ * Returns the rows in the given trigram index that could match the given query, or `NULL` if the
+ * index is not ready or the query has no token long enough to look up.
+ * A row could match if its key has every trigram of every token in the query. The returned list
+ * is in ascending order and must be freed when finished.
+ * @param index The trigram index, or `NULL`.
+ * @param query The case-folded query.
+ * @param len Pointer to the number of rows returned, which is set.
+ */
+static int *trigram_candidates(const TrigramIndex *index, const char *query, int *len) {
+  if (!index || !atomic_get(&index->ready)) return NULL;
+  size_t n = 0, query_len = strlen(query);
+  unsigned int *buckets = malloc(sizeof(unsigned int) * (query_len + 1));
+  for (const char *p = query; *p; p++)
+    if (p[0] != ' ' && p[1] && p[1] != ' ' && p[2] && p[2] != ' ')
+      buckets[n++] = trigram_bucket(p);
+  if (n == 0) return (free(buckets), NULL);
+  // Start with the smallest list of rows and intersect the others with it.
+  size_t smallest = 0;
+  for (size_t i = 1; i < n; i++)
+    if (index->offsets[buckets[i] + 1] - index->offsets[buckets[i]] <
+      index->offsets[buckets[smallest] + 1] - index->offsets[buckets[smallest]])
+      smallest = i;
+  const int *first = index->postings + index->offsets[buckets[smallest]];
+  int m = index->offsets[buckets[smallest] + 1] - index->offsets[buckets[smallest]];
+  int *rows = memcpy(malloc(sizeof(int) * (m + 1)), first, sizeof(int) * m);
+  for (size_t i = 0; i < n && m > 0; i++) {
+    if (buckets[i] == buckets[smallest]) continue;
+    const int *p = index->postings + index->offsets[buckets[i]];
+    const int *end = index->postings + index->offsets[buckets[i] + 1];
+    int k = 0;
+    for (int j = 0; j < m && p < end; j++) {
+      while (p < end && *p < rows[j]) p++;
+      if (p < end && *p == rows[j]) rows[k++] = rows[j];
+    }
+    m = k;
+  }
+  free(buckets);
+  return (*len = m, rows);
+}
+
+/** Stops building the given trigram index and frees it. */
+static void free_trigram_index(TrigramIndex *index) {
+  atomic_set(&index->cancelled, TRUE);
+#if GTK
+  if (index->started) g_thread_join(index->thread);
+#elif !_WIN32
+  if (index->started) pthread_join(index->thread, NULL);
+#endif
+  free(index->offsets), free(index->postings);
+  index->offsets = NULL, index->postings = NULL, index->started = FALSE, index->ready = FALSE;
+}
+
+/** The minimum number of filteredlist rows worth matching on a separate thread. */
+#define FILTER_SLICE_MIN 16384
+/** The maximum number of threads to match filteredlist rows on. */
+#define FILTER_THREADS_MAX 64
+
+/** A slice of candidate filteredlist rows to match, possibly on a worker thread. */
+typedef struct FilterSlice {
+  /** The candidate rows, or NULL if candidates are consecutive rows starting at *first*. */
+  const int *rows;
+  /** The first candidate row if *rows* is NULL. */
+  int first;
+  /** The index of the slice's first candidate. */
+  int start;
+  /** The index just past the slice's last candidate. */
+  int end;
+  /** Function that returns whether or not a given row matches. */
+  int (*visible)(int row, void *userdata);
+  /** Userdata to pass to *visible*. */
+  void *userdata;
+  /** The matching rows, in order. There is room for one per candidate. */
+  int *matches;
+  /** The number of matching rows. */
+  int len;
+  /** The set of slices being matched on worker threads this slice is part of, if any. */
+  void *job;
+  /** The next slice waiting for a worker thread, if any. */
+  struct FilterSlice *next;
+} FilterSlice;
+
+/** Matches the given slice of candidate filteredlist rows. */
+static void filter_slice(FilterSlice *slice) {
+  for (int i = slice->start; i < slice->end; i++) {
+    int row = slice->rows ? slice->rows[i] : slice->first + i;
+    if (slice->visible(row, slice->userdata)) slice->matches[slice->len++] = row;
+  }
+}
+
+#if GTK
+/** A set of filteredlist slices being matched on worker threads. */
+typedef struct {
+  GMutex mutex;
+  GCond cond;
+  /** The number of slices still being matched. */
+  int pending;
+} FilterJob;
+
+/** The pool of filteredlist worker threads, which lives as long as any filter does. */
+static GThreadPool *filter_pool;
+
+/** Function for matching a slice of filteredlist rows on a worker thread. */
+static void filter_slice_thread(gpointer data, gpointer userdata) {
+  FilterSlice *slice = (FilterSlice *)data;
+  FilterJob *job = (FilterJob *)slice->job;
+  filter_slice(slice);
+  g_mutex_lock(&job->mutex);
+  if (--job->pending == 0) g_cond_signal(&job->cond);
+  g_mutex_unlock(&job->mutex);
+}
+#elif !_WIN32
+/** A set of filteredlist slices being matched on worker threads. */
+typedef struct {
+  /** The number of slices still being matched. It is guarded by `filter_lock`. */
+  int pending;
+} FilterJob;
+
+// The pool of filteredlist worker threads, which lives as long as any filter does.
+// Threads are started as they are needed, and wait for slices to be queued.
+static pthread_mutex_t filter_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t filter_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t filter_done = PTHREAD_COND_INITIALIZER;
+static pthread_t filter_threads[FILTER_THREADS_MAX];
+static int filter_nthreads, filter_quit;
+/** The slices waiting for a worker thread, most recently queued first. */
+static FilterSlice *filter_queue;
+
+/**
+ * Matches the next queued slice of filteredlist rows and signals when its set of slices is done.
+ * `filter_lock` must be held. It is released while matching.
+ */
+static void filter_next_slice(void) {
+  FilterSlice *slice = filter_queue;
+  filter_queue = slice->next;
+  pthread_mutex_unlock(&filter_lock), filter_slice(slice), pthread_mutex_lock(&filter_lock);
+  if (--((FilterJob *)slice->job)->pending == 0) pthread_cond_broadcast(&filter_done);
+}
+
+/** Function for matching queued slices of filteredlist rows on a worker thread. */
+static void *filter_slice_thread(void *data) {
+  pthread_mutex_lock(&filter_lock);
+  while (filter_queue || !filter_quit)
+    if (filter_queue)
+      filter_next_slice();
+    else
+      pthread_cond_wait(&filter_work, &filter_lock);
+  return (pthread_mutex_unlock(&filter_lock), NULL);
+}
+#endif
+
+/** The number of initialized filters, which keep the pool of worker threads alive. */
+static int filter_users;
+#if GTK
+G_LOCK_DEFINE_STATIC(filter_users);
+#elif !_WIN32
+/** The lock for `filter_users`, held while the pool of worker threads is started or stopped. */
+static pthread_mutex_t filter_users_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/** Returns the number of processors available to match filteredlist rows on. */
+static int num_processors(void) {
+#if GTK
+  return g_get_num_processors();
+#elif !_WIN32
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n > 0) ? n : 1;
+#else
+  return 1;
+#endif
+}
+
+/**
+ * Matches the given candidate filteredlist rows, splitting large sets of candidates into slices
+ * that are matched in parallel on worker threads.
+ * @param rows The candidate rows, or NULL if candidates are consecutive rows starting at *first*.
+ * @param first The first candidate row if *rows* is NULL.
+ * @param n The number of candidates.
+ * @param visible Function that returns whether or not a given row matches.
+ * @param userdata Userdata to pass to *visible*. It must be safe to call *visible* with it from
+ *   multiple threads at once.
+ * @param matches The list to store matching rows in, in order. It must have room for *n* rows.
+ * @return number of matching rows
+ */
+static int filter_candidates(const int *rows, int first, int n,
+  int (*visible)(int row, void *userdata), void *userdata, int *matches) {
+  int nslices = n / FILTER_SLICE_MIN, nprocs = num_processors();
+  if (nslices > nprocs) nslices = nprocs;
+  if (nslices > FILTER_THREADS_MAX) nslices = FILTER_THREADS_MAX;
+  if (nslices < 1) nslices = 1;
+  FilterSlice slices[nslices];
+  for (int i = 0; i < nslices; i++) {
+    int start = (long long)n * i / nslices, end = (long long)n * (i + 1) / nslices;
+    FilterSlice slice = {
+      rows, first, start, end, visible, userdata, matches + start, 0, NULL, NULL};
+    slices[i] = slice;
+  }
+  // Match the first slice on this thread and any others on worker threads.
+#if GTK
+  FilterJob job = {{0}, {0}, nslices - 1};
+  if (nslices > 1) {
+    g_mutex_init(&job.mutex), g_cond_init(&job.cond);
+    for (int i = 1; i < nslices; i++) slices[i].job = &job;
+    for (int i = 1; i < nslices; i++) g_thread_pool_push(filter_pool, &slices[i], NULL);
+  }
+  filter_slice(&slices[0]);
+  if (nslices > 1) {
+    g_mutex_lock(&job.mutex);
+    while (job.pending > 0) g_cond_wait(&job.cond, &job.mutex);
+    g_mutex_unlock(&job.mutex);
+    g_mutex_clear(&job.mutex), g_cond_clear(&job.cond);
+  }
+#elif !_WIN32
+  FilterJob job = {nslices - 1};
+  if (nslices > 1) {
+    pthread_mutex_lock(&filter_lock);
+    while (filter_nthreads < nslices - 1 &&
+      pthread_create(&filter_threads[filter_nthreads], NULL, filter_slice_thread, NULL) == 0)
+      filter_nthreads++;
+    for (int i = 1; i < nslices; i++)
+      slices[i].job = &job, slices[i].next = filter_queue, filter_queue = &slices[i];
+    pthread_cond_broadcast(&filter_work), pthread_mutex_unlock(&filter_lock);
+  }
+  filter_slice(&slices[0]);
+  if (nslices > 1) {
+    // Help match queued slices while waiting, in case there are too few worker threads.
+    pthread_mutex_lock(&filter_lock);
+    while (job.pending > 0)
+      if (filter_queue)
+        filter_next_slice();
+      else
+        pthread_cond_wait(&filter_done, &filter_lock);
+    pthread_mutex_unlock(&filter_lock);
+  }
+#else
+  for (int i = 0; i < nslices; i++) filter_slice(&slices[i]);
+#endif
+  // Merge matches in order.
+  int len = slices[0].len;
+  for (int i = 1; i < nslices; i++)
+    memmove(matches + len, slices[i].matches, sizeof(int) * slices[i].len), len += slices[i].len;
+  return len;
+}
+
+/** The number of candidate rows matched between progress reports while filtering. */
+#define FILTER_CHUNK 65536
+
+/**
+ * Matches candidate rows against a query and appends matches to the given result, reporting
+ * progress after each chunk of candidates.
+ * @param result The result to append matching rows to.
+ * @param rows The list of candidate rows, or `NULL` for the rows starting at *first*.
+ * @param first The first candidate row when *rows* is `NULL`.
+ * @param n The number of candidate rows.
+ * @param visible Function that returns whether or not a given row matches the query.
+ * @param progress Optional function to report progress to. If it returns `FALSE`, matching
+ *   stops.
+ * @param userdata Userdata to pass to *visible* and *progress*.
+ * @return `FALSE` if *progress* stopped matching, `TRUE` otherwise
+ */
+static int filter_chunks(FilterResult *result, const int *rows, int first, int n,
+  int (*visible)(int row, void *userdata),
+  int (*progress)(const int *rows, int len, void *userdata), void *userdata) {
+  for (int i = 0, chunk = progress ? FILTER_CHUNK : n; i < n; i += chunk) {
+    int m = n - i < chunk ? n - i : chunk;
+    result->len += filter_candidates(
+      rows ? rows + i : NULL, first + i, m, visible, userdata, result->rows + result->len);
+    if (progress && !progress(result->rows, result->len, userdata)) return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+ * Returns the rows that match the given query, using cached results where possible.
+ * If the query is a refinement of a cached query (i.e. it extends it), only that query's
+ * matching rows are scanned. If the query itself is cached, only rows added since it was last
+ * used are scanned. Otherwise, or if it narrows things down further, the given trigram index is
+ * used to find the indexed rows worth scanning.
+ * @param cache The cache of recent results.
+ * @param index Optional trigram index of rows. It should be `NULL` for fuzzy queries.
+ * @param query The lowercase query.
+ * @param num_rows The total number of rows.
+ * @param visible Function that returns whether or not a given row matches the query. It may be
+ *   called from multiple threads at once.
+ * @param progress Optional function that is periodically passed the rows matched so far. If it
+ *   returns `FALSE`, filtering is cancelled.
+ * @param userdata Userdata to pass to *visible* and *progress*.
+ * @param len Pointer to the number of matching rows, which is set.
+ * @return list of matching rows, in ascending order, or `NULL` if filtering was cancelled. It is
+ *   owned by the cache and remains valid until the cache is used or freed again.
+ */
+static int *cached_rows(FilterCache *cache, const TrigramIndex *index, const char *query,
+  int num_rows, int (*visible)(int row, void *userdata),
+  int (*progress)(const int *rows, int len, void *userdata), void *userdata, int *len) {
+  // Find the closest cached query that the query refines.
+  int best = -1;
+  size_t best_len = 0, query_len = strlen(query);
+  for (int i = 0; i < cache->len; i++) {
+    size_t n = strlen(cache->results[i].query);
+    if ((best == -1 || n > best_len) && n <= query_len &&
+      strncmp(cache->results[i].query, query, n) == 0)
+      best = i, best_len = n;
+  }
+  FilterResult result;
+  int done = TRUE;
+  if (best != -1 && best_len == query_len) {
+    result = cache->results[best];
+    memmove(&cache->results[best], &cache->results[best + 1],
+      sizeof(FilterResult) * (--cache->len - best));
+    int added = num_rows - result.scanned; // rows added since, which may match too
+    if (added > 0) result.rows = realloc(result.rows, sizeof(int) * (result.len + added + 1));
+  } else {
+    result.query = copy(query), result.rows = malloc(sizeof(int) * (num_rows + 1));
+    result.len = 0, result.scanned = 0;
+    int ncandidates, *candidates = trigram_candidates(index, query, &ncandidates);
+    if (candidates && (best == -1 || ncandidates < cache->results[best].len)) {
+      done = filter_chunks(&result, candidates, 0, ncandidates, visible, progress, userdata);
+      result.scanned = index->len;
+    } else if (best != -1) {
+      FilterResult *base = &cache->results[best];
+      done = filter_chunks(&result, base->rows, 0, base->len, visible, progress, userdata);
+      result.scanned = base->scanned;
+    }
+    free(candidates);
+  }
+  if (done)
+    done = filter_chunks(&result, NULL, result.scanned, num_rows - result.scanned, visible,
+      progress, userdata);
+  if (!done) return (free(result.query), free(result.rows), *len = 0, NULL);
+  result.scanned = num_rows;
+  result.rows = realloc(result.rows, sizeof(int) * (result.len + 1)); // cache only what matched
+  if (cache->len == FILTER_CACHE_SIZE) {
+    FilterResult *last = &cache->results[--cache->len];
+    free(last->query), free(last->rows);
+  }
+  memmove(&cache->results[1], &cache->results[0], sizeof(FilterResult) * cache->len++);
+  cache->results[0] = result;
+  return (*len = result.len, result.rows);
+}
+
+/** Frees the given filteredlist query cache's results. */
+static void free_filter_cache(FilterCache *cache) {
+  for (int i = 0; i < cache->len; i++) free(cache->results[i].query), free(cache->results[i].rows);
+  cache->len = 0;
+}
+
+/**
+ * Returns a pointer to the first occurrence of the given token in the given case-folded key, or
+ * `NULL` if there is none.
+ * This is the portable kernel used when no vectorized one is available.
+ * @param key The key to search. It need not be '\0'-terminated.
+ * @param len The length of *key*.
+ * @param token The token to search for.
+ * @param n The length of *token*. It must be greater than 0.
+ */
+static const char *find_token(const char *key, size_t len, const char *token, size_t n) {
+  if (n > len) return NULL;
+  for (const char *p = key, *end = key + len - n + 1; p < end; p++) {
+    if (!(p = memchr(p, *token, end - p))) return NULL;
+    if (memcmp(p, token, n) == 0) return p;
+  }
+  return NULL;
+}
+
+#if HAVE_SIMD
+/**
+ * Defines a vectorized version of find_token() that compares *width* candidate positions at a
+ * time: the token's first and last characters are compared against a block of the key and
+ * the same block shifted by the token's length, and only positions where both match are
+ * compared in full. Any positions too close to the end of the key for a full block are checked
+ * one at a time.
+ */
+#define FIND_TOKEN_SIMD(name, isa, width, vec, set1, loadu, cmpeq, and, movemask) \
+  __attribute__((target(isa))) static const char *name( \
+    const char *key, size_t len, const char *token, size_t n) { \
+    if (n > len) return NULL; \
+    const vec first = set1(token[0]), last = set1(token[n - 1]); \
+    size_t i = 0; \
+    for (; i + n - 1 + width <= len; i += width) { \
+      vec a = loadu((const vec *)(key + i)), b = loadu((const vec *)(key + i + n - 1)); \
+      unsigned int mask = movemask(and(cmpeq(a, first), cmpeq(b, last))); \
+      for (; mask; mask &= mask - 1) \
+        if (memcmp(key + i + __builtin_ctz(mask), token, n) == 0) \
+          return key + i + __builtin_ctz(mask); \
+    } \
+    return find_token(key + i, len - i, token, n); \
+  }
+FIND_TOKEN_SIMD(find_token_sse2, "sse2", 16, __m128i, _mm_set1_epi8, _mm_loadu_si128,
+  _mm_cmpeq_epi8, _mm_and_si128, _mm_movemask_epi8)
+FIND_TOKEN_SIMD(find_token_avx2, "avx2", 32, __m256i, _mm256_set1_epi8, _mm256_loadu_si256,
+  _mm256_cmpeq_epi8, _mm256_and_si256, _mm256_movemask_epi8)
+#endif
+
+/** Returns the fastest token finder the processor supports. */
+static TokenFinder token_finder(void) {
+#if HAVE_SIMD
+  return __builtin_cpu_supports("avx2") ? find_token_avx2 : find_token_sse2;
+#else
+  return find_token;
+#endif
+}
+
+void filter_set_matcher(Matcher *matcher, const char *query) {
+  free(matcher->text), free(matcher->tokens), free(matcher->lens);
+  matcher->text = copy(query), matcher->len = 0, matcher->mask = 0;
+  matcher->tokens = malloc(sizeof(char *) * (strlen(query) / 2 + 1));
+  matcher->lens = malloc(sizeof(size_t) * (strlen(query) / 2 + 1));
+  if (!matcher->find) matcher->find = token_finder();
+  for (char *p = matcher->text, *token; *p;) {
+    while (*p == ' ') *p++ = '\0';
+    if (!*(token = p)) break;
+    for (; *p && *p != ' '; p++) matcher->mask |= char_bit(*p);
+    matcher->tokens[matcher->len] = token, matcher->lens[matcher->len++] = p - token;
+  }
+}
+
+int filter_match(const Matcher *matcher, const Keys *keys, int row) {
+  if ((keys->masks[row] & matcher->mask) != matcher->mask) return FALSE; // missing characters
+  const char *key = key_text(keys, row), *end = key + item_len(&keys->text, row);
+  for (int i = 0; i < matcher->len; i++)
+    if (!matcher->fuzzy) {
+      if (!(key = matcher->find(key, end - key, matcher->tokens[i], matcher->lens[i])))
+        return FALSE;
+      key += matcher->lens[i];
+    } else {
+      const char *t = matcher->tokens[i];
+      for (const char *p = key; *p && *t; p++)
+        if (*p == *t) t++;
+      if (*t) return FALSE;
+    }
+  return TRUE;
+}
+
+void filter_free_matcher(Matcher *matcher) {
+  free(matcher->text), free(matcher->tokens), free(matcher->lens);
+  matcher->text = NULL, matcher->tokens = NULL, matcher->lens = NULL;
+}
+
+// Fuzzy match scoring.
+#define FUZZY_MATCH 16
+#define FUZZY_GAP 1
+#define FUZZY_RUN_BONUS 8
+#define FUZZY_WORD_BONUS 8
+#define FUZZY_PATH_BONUS 12
+/** The number of best fuzzy matches that are fully sorted. */
+#define FUZZY_TOP_K 1000
+
+/**
+ * Returns the fuzzy score of the given token in the given case-folded key, or -1 if the token's
+ * characters do not all appear in order in the key.
+ * The shortest window that ends where the token first fully matches is scored. Each matched
+ * character scores points, with bonuses for characters that start a word or path component and
+ * for runs of consecutive characters, and each skipped character in between costs a point.
+ */
+static int fuzzy_score(const char *token, const char *key) {
+  const char *t = token, *p = key, *end;
+  for (; *p && *t; p++)
+    if (*p == *t) t++;
+  if (*t) return -1;
+  for (end = --p, t--;; p--) // walk back to the latest possible start of the match
+    if (*p == *t && t-- == token) break;
+  int score = 0, run = 0;
+  for (t = token; p <= end && *t; p++) {
+    if (*p != *t) {
+      score -= FUZZY_GAP, run = 0;
+      continue;
+    }
+    score += FUZZY_MATCH, t++;
+    if (p == key || p[-1] == '/' || p[-1] == '\\')
+      score += FUZZY_PATH_BONUS;
+    else if (!isalnum((unsigned char)p[-1]) && !(p[-1] & 0x80))
+      score += FUZZY_WORD_BONUS;
+    if (run++ > 0) score += FUZZY_RUN_BONUS;
+  }
+  return (score > 0) ? score : 0;
+}
+
+/** A filteredlist row and its fuzzy score. */
+typedef struct {
+  int score;
+  int row;
+} Ranked;
+
+/** Returns whether or not ranked row *a* ranks better than ranked row *b*. */
+#define ranks_better(a, b) ((a).score > (b).score || ((a).score == (b).score && (a).row < (b).row))
+
+/** qsort() comparison function for sorting ranked rows best first. */
+static int compare_ranked(const void *a, const void *b) {
+  const Ranked *ra = (const Ranked *)a, *rb = (const Ranked *)b;
+  return ranks_better(*ra, *rb) ? -1 : ranks_better(*rb, *ra);
+}
+
+void filter_rank(const Matcher *matcher, const Keys *keys, int *rows, int len) {
+  int k = (len < FUZZY_TOP_K) ? len : FUZZY_TOP_K, n = 0, m = 0;
+  if (k == 0) return;
+  Ranked *heap = malloc(sizeof(Ranked) * k);
+  int *scores = malloc(sizeof(int) * len);
+  for (int i = 0; i < len; i++) {
+    Ranked r = {0, rows[i]};
+    for (int j = 0; j < matcher->len; j++)
+      r.score += fuzzy_score(matcher->tokens[j], key_text(keys, rows[i]));
+    scores[i] = r.score;
+    int j = n, c;
+    if (n < k)
+      for (n++; j > 0 && ranks_better(heap[(j - 1) / 2], r); j = (j - 1) / 2) // sift up
+        heap[j] = heap[(j - 1) / 2];
+    else if (ranks_better(r, heap[0]))
+      for (j = 0; (c = 2 * j + 1) < n; j = c) { // replace the worst row and sift down
+        if (c + 1 < n && ranks_better(heap[c], heap[c + 1])) c++;
+        if (!ranks_better(r, heap[c])) break;
+        heap[j] = heap[c];
+      }
+    else
+      continue;
+    heap[j] = r;
+  }
+  // Move rows that rank worse than the worst of the best to the end, in order.
+  for (int i = 0; i < len; i++) {
+    Ranked r = {scores[i], rows[i]};
+    if (ranks_better(heap[0], r)) rows[m++] = rows[i];
+  }
+  memmove(rows + k, rows, sizeof(int) * m);
+  qsort(heap, k, sizeof(Ranked), compare_ranked);
+  for (int i = 0; i < k; i++) rows[i] = heap[i].row;
+  free(heap), free(scores);
+}
+
+
+/**
+ * Returns a case-folded copy of the given text, folded the same way search keys are.
+ * The returned string must be freed when finished.
+ */
+static char *fold(const char *s) {
+#if GTK
+  char *lower = g_utf8_strdown(s, -1), *folded = copy(lower);
+  g_free(lower);
+#else
+  char *folded = copy(s);
+#endif
+  for (char *p = folded; *p; p++) *p = tolower((unsigned char)*p);
+  return folded;
+}
+
+/**
+ * Returns whether or not the given row matches the current query of the filter in userdata.
+ * An incomplete row missing its search column's item has an empty key, so it only matches an empty
+ * query.
+ */
+static int filter_visible(int row, void *userdata) {
+  Filter *filter = (Filter *)userdata;
+  return filter->matcher.len == 0 || filter_match(&filter->matcher, &filter->keys, row);
+}
+
+void filter_init(Filter *filter, int ncols, int search_col, FilterKind kind) {
+  memset(filter, 0, sizeof(Filter));
+  filter->ncols = (ncols > 0) ? ncols : 1, filter->search_col = (search_col > 0) ? search_col : 1;
+  if (filter->search_col > filter->ncols) filter->search_col = filter->ncols;
+  filter->matcher.fuzzy = kind == FILTER_FUZZY;
+#if GTK
+  G_LOCK(filter_users);
+  if (filter_users++ == 0) // a shared pool starts no threads until it has work
+    filter_pool = g_thread_pool_new(filter_slice_thread, NULL, -1, FALSE, NULL);
+  G_UNLOCK(filter_users);
+#elif !_WIN32
+  pthread_mutex_lock(&filter_users_lock), filter_users++, pthread_mutex_unlock(&filter_users_lock);
+#else
+  filter_users++;
+#endif
+}
+
+int filter_load(Filter *filter, const char **items, int len, int fd, int map, char delim) {
+  return load_items(&filter->items, items, len, fd, map, delim);
+}
+
+void filter_add_item(Filter *filter, const char *item, size_t len) {
+  add_item(&filter->items, item, len);
+}
+
+int filter_add_rows(Filter *filter, int partial) {
+  Items *items = &filter->items;
+  int ncols = filter->ncols, len = items->len, first = filter->num_rows;
+  int num_rows = partial ? (len + ncols - 1) / ncols : len / ncols;
+  for (; filter->num_rows < num_rows; filter->num_rows++) {
+    int i = filter->num_rows * ncols + filter->search_col - 1;
+    if (i < len)
+      add_key(&filter->keys, item_text(items, i), item_len(items, i));
+    else
+      add_key(&filter->keys, "", 0); // incomplete row missing its search column
+  }
+  return first;
+}
+
+void filter_index(Filter *filter) {
+  start_trigram_index(&filter->index, &filter->keys, filter->items.len / filter->ncols);
+}
+
+const char *filter_item(const Filter *filter, int row, int col, size_t *len) {
+  int i = row * filter->ncols + col;
+  if (row < 0 || col < 0 || col >= filter->ncols || i >= filter->items.len) return NULL;
+  if (len) *len = item_len(&filter->items, i);
+  return item_text(&filter->items, i);
+}
+
+int filter_set_query(Filter *filter, const char *text) {
+  char *query = fold(text);
+  if (filter->query && strcmp(query, filter->query) == 0) return (free(query), FALSE);
+  free(filter->query), filter->query = query;
+  filter_set_matcher(&filter->matcher, filter->query);
+  return TRUE;
+}
+
+int *filter_rows(Filter *filter, const char *query, const Matcher *matcher, int num_rows,
+  int (*visible)(int row, void *userdata),
+  int (*progress)(const int *rows, int len, void *userdata), void *userdata, int *len) {
+  return cached_rows(&filter->cache, !matcher->fuzzy ? &filter->index : NULL, query, num_rows,
+    visible, progress, userdata, len);
+}
+
+int *filter_matches(Filter *filter, int *len) {
+  if (!filter->query) filter_set_query(filter, "");
+  int *rows = filter_rows(filter, filter->query, &filter->matcher, filter->num_rows,
+    filter_visible, NULL, filter, len);
+  if (!filter->matcher.fuzzy || filter->matcher.len == 0) return rows;
+  filter->ranked = realloc(filter->ranked, sizeof(int) * (*len + 1));
+  rows = memcpy(filter->ranked, rows, sizeof(int) * *len);
+  filter_rank(&filter->matcher, &filter->keys, rows, *len);
+  return rows;
+}
+
+void filter_free(Filter *filter) {
+  free_trigram_index(&filter->index); // stop indexing keys before freeing them
+  free_filter_cache(&filter->cache), filter_free_matcher(&filter->matcher);
+  free_keys(&filter->keys), free_items(&filter->items);
+  free(filter->query), free(filter->ranked);
+  filter->query = NULL, filter->ranked = NULL;
+  // Stop the pool of worker threads once no filter can use it.
+#if GTK
+  G_LOCK(filter_users);
+  if (--filter_users == 0) g_thread_pool_free(filter_pool, FALSE, TRUE), filter_pool = NULL;
+  G_UNLOCK(filter_users);
+#elif !_WIN32
+  pthread_mutex_lock(&filter_users_lock);
+  if (--filter_users == 0) {
+    pthread_mutex_lock(&filter_lock);
+    filter_quit = TRUE, pthread_cond_broadcast(&filter_work), pthread_mutex_unlock(&filter_lock);
+    for (int i = 0; i < filter_nthreads; i++) pthread_join(filter_threads[i], NULL);
+    filter_nthreads = 0, filter_quit = FALSE;
+  }
+  pthread_mutex_unlock(&filter_users_lock);
+#else
+  filter_users--;
+#endif
+}
@@ -0,0 +1,384 @@
+/**
+ * The filteredlist filter engine shared by gtDialog's GTK and curses dialogs.
+ *
+ * The MIT License
+ *
+ * Copyright (c) 2009-2022 Mitchell
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#if GTK
+#include <glib.h>
+#elif !_WIN32
+#include <pthread.h>
+#endif
+
+/** The number of bytes to read at a time from a stream of filteredlist items. */
+#define ITEMS_BATCH 65536
+
+/** A reader of delimited filteredlist items from a stream. */
+typedef struct {
+  /** The buffer of data read, starting with any incomplete item left over from the last read. */
+  char *buf;
+  /** The number of bytes in *buf*. */
+  size_t len;
+  /** The allocated size of *buf*. */
+  size_t size;
+  /** The character that delimits items. */
+  char delim;
+  /** The function to call with each complete item read, along with its userdata. */
+  void (*add_item)(char *item, void *userdata);
+  void *userdata;
+} ItemReader;
+
+/**
+ * A flat list of filteredlist items.
+ * Items are stored back to back in a single block of data, each followed by a one-byte delimiter,
+ * and are located by their offsets into that data. The data is either owned, in which case items
+ * are '\0'-delimited, or it is a read-only memory map of a file, in which case items are only
+ * delimited by the file's delimiter and are not '\0'-terminated.
+ */
+typedef struct {
+  /** The item data. */
+  char *data;
+  /** The number of bytes of item data. */
+  size_t size;
+  /** The allocated size of owned item data. */
+  size_t capacity;
+  /**
+   * The offset of each item in *data*, followed by the offset just past the last item's
+   * delimiter.
+   */
+  size_t *offsets;
+  /** The number of items. */
+  int len;
+  /** The allocated number of *offsets*. */
+  int offsets_size;
+  /** Whether or not *data* is memory-mapped. */
+  int mapped;
+  /** Whether or not items' trailing '\r' is excluded from their length, like streamed items'. */
+  int chomp_cr;
+} Items;
+
+/** Returns a pointer to the start of item *i* in the given list of items. */
+#define item_text(items, i) ((items)->data + (items)->offsets[i])
+/** Returns the length of item *i* in the given list of items. */
+#define item_len(items, i) \
+  ((items)->offsets[(i) + 1] - (items)->offsets[i] - 1 - \
+    ((items)->chomp_cr && (items)->offsets[(i) + 1] - (items)->offsets[i] > 1 && \
+      (items)->data[(items)->offsets[(i) + 1] - 2] == '\r'))
+
+/** Case-folded filteredlist search keys. */
+typedef struct {
+  /** The keys, one per row. */
+  Items text;
+  /** The set of characters in each key, as a bitmask of char_bit()s. */
+  uint64_t *masks;
+  /** The allocated number of *masks*. */
+  int masks_size;
+} Keys;
+
+/**
+ * An index of the trigrams in filteredlist search keys.
+ * It maps each trigram's bucket to the list of rows whose keys contain a trigram in that bucket,
+ * so rows that could match a query are found without scanning every key. It is built in the
+ * background once all rows have been added.
+ */
+typedef struct {
+  /** The search keys being indexed. */
+  const Keys *keys;
+  /** The number of rows indexed. */
+  int len;
+  /**
+   * The offset of each bucket's rows in *postings*, followed by the offset just past the last
+   * bucket's rows.
+   */
+  size_t *offsets;
+  /** The rows of each bucket, in ascending order, back to back. */
+  int *postings;
+  /** Whether or not the index is ready to be used. It is accessed atomically. */
+  int ready;
+  /** Whether or not indexing was cancelled. It is accessed atomically. */
+  int cancelled;
+  /** Whether or not indexing was started. */
+  int started;
+#if GTK
+  /** The thread the index is built in. */
+  GThread *thread;
+#elif !_WIN32
+  /** The thread the index is built in. */
+  pthread_t thread;
+#endif
+} TrigramIndex;
+
+/** The number of filteredlist queries whose results are cached. */
+#define FILTER_CACHE_SIZE 8
+
+/** A filteredlist query and the rows that match it. */
+typedef struct {
+  /** The lowercase query. */
+  char *query;
+  /** The indices of matching rows, in ascending order. */
+  int *rows;
+  /** The number of matching rows. */
+  int len;
+  /** The number of rows that have been matched against the query. */
+  int scanned;
+} FilterResult;
+
+/**
+ * A cache of recent filteredlist query results, most recently used first.
+ * Since rows never change once added, a result stays valid as long as rows added after it was
+ * computed are matched too.
+ */
+typedef struct {
+  /** The cached results. */
+  FilterResult results[FILTER_CACHE_SIZE];
+  /** The number of cached results. */
+  int len;
+} FilterCache;
+
+/** A function that finds a token in a key, with the same signature as find_token(). */
+typedef const char *(*TokenFinder)(const char *key, size_t len, const char *token, size_t n);
+
+/** A prepared filteredlist query. */
+typedef struct {
+  /** The query's tokens, each '\0'-terminated, back to back. */
+  char *text;
+  /** The non-empty tokens to match. */
+  char **tokens;
+  /** The number of tokens. */
+  int len;
+  /** The set of characters in the query, as a bitmask of char_bit()s. */
+  uint64_t mask;
+  /**
+   * Whether or not to match tokens fuzzily (i.e. as subsequences in any order) instead of as
+   * substrings in order.
+   */
+  int fuzzy;
+  /** The lengths of tokens. */
+  size_t *lens;
+  /** The function that finds tokens in keys. */
+  TokenFinder find;
+} Matcher;
+
+/** The kinds of filteredlist matching. */
+typedef enum {
+  /** Query tokens must appear in a row's key as substrings, in order. */
+  FILTER_SUBSTRING,
+  /** Query tokens must appear in a row's key as subsequences, and matches are ranked. */
+  FILTER_FUZZY
+} FilterKind;
+
+/**
+ * A filter of rows of delimited items against a query.
+ * Rows are made of *ncols* consecutive items and are matched against the case-folded key of
+ * their *search_col* item. Rows never change once added.
+ */
+typedef struct {
+  /** The number of columns in a row. */
+  int ncols;
+  /** The 1-based column rows are matched against. */
+  int search_col;
+  /** The items. */
+  Items items;
+  /** The number of rows, complete or not. */
+  int num_rows;
+  /** The case-folded search key of each row. */
+  Keys keys;
+  /** The case-folded text of the current query, or `NULL`. */
+  char *query;
+  /** The prepared current query. */
+  Matcher matcher;
+  /** The cache of recent query results. */
+  FilterCache cache;
+  /** The trigram index of complete rows, built once all items are loaded. */
+  TrigramIndex index;
+  /** The rows matching the current query in ranked order for fuzzy queries. */
+  int *ranked;
+} Filter;
+
+/**
+ * Initializes the given filter with no items.
+ * @param filter The filter to initialize.
+ * @param ncols The number of columns in a row.
+ * @param search_col The 1-based column to match rows against.
+ * @param kind The kind of matching to do.
+ */
+void filter_init(Filter *filter, int ncols, int search_col, FilterKind kind);
+
+/**
+ * Loads the given filter's initial items.
+ * If the given file descriptor is to be and can be memory-mapped, its items are used in place of
+ * the given items. Otherwise the given items are copied, and the file descriptor is the one to
+ * stream the remaining items from, e.g. with an ItemReader whose callback calls
+ * `filter_add_item()`.
+ * @param filter The filter, which must not have any items yet.
+ * @param items The items to copy.
+ * @param len The number of items in *items*.
+ * @param fd The file descriptor to load items from, or -1.
+ * @param map Whether or not to try memory-mapping the file descriptor.
+ * @param delim The character that delimits items read from the file descriptor.
+ * @return file descriptor to stream items from, or -1 if there is none or it was mapped
+ */
+int filter_load(Filter *filter, const char **items, int len, int fd, int map, char delim);
+
+/**
+ * Appends a copy of the given item to the given filter.
+ * The item is not part of a row until `filter_add_rows()` is called.
+ * @param filter The filter.
+ * @param item The item to append. It need not be '\0'-terminated.
+ * @param len The length of *item*.
+ */
+void filter_add_item(Filter *filter, const char *item, size_t len);
+
+/**
+ * Adds rows to the given filter for its items that are not yet part of a row.
+ * @param filter The filter.
+ * @param partial Whether or not to create a row for a trailing, incomplete set of items. Since
+ *   rows never change, this should only be done once all items are loaded.
+ * @return the first row added, or the number of rows if none were added
+ */
+int filter_add_rows(Filter *filter, int partial);
+
+/**
+ * Starts indexing the given filter's rows in the background if there are enough of them to be
+ * worth it.
+ * This should only be done once all items are loaded and all rows are added.
+ * @param filter The filter.
+ */
+void filter_index(Filter *filter);
+
+/**
+ * Returns a pointer to the given item of the given filter, or `NULL` if there is no such item.
+ * Items are not '\0'-terminated if they were memory-mapped.
+ * @param filter The filter.
+ * @param row The row of the item.
+ * @param col The 0-based column of the item.
+ * @param len Optional pointer to the length of the item, which is set.
+ */
+const char *filter_item(const Filter *filter, int row, int col, size_t *len);
+
+/**
+ * Sets the given filter's query from the given text, which is case-folded.
+ * @param filter The filter.
+ * @param text The query text, whose space-separated tokens must all match.
+ * @return `TRUE` if the query changed, `FALSE` otherwise
+ */
+int filter_set_query(Filter *filter, const char *text);
+
+/**
+ * Returns the rows of the given filter that match its current query.
+ * An incomplete row that is missing its search column's item has an empty key, so it only matches
+ * an empty query.
+ * @param filter The filter.
+ * @param len Pointer to the number of matching rows, which is set.
+ * @return list of matching rows, in ascending order, or best match first for fuzzy queries. It is
+ *   owned by the filter and remains valid until the filter is used or freed again.
+ */
+int *filter_matches(Filter *filter, int *len);
+
+/**
+ * Returns the rows of the given filter that the given function says match the given query, using
+ * the filter's cache of recent results and its trigram index where possible.
+ * This is for matching with a query other than the filter's current one (e.g. on a background
+ * thread while the current query changes), or with a different notion of a row matching.
+ * @param filter The filter. Only one call may use it at a time.
+ * @param query The case-folded query.
+ * @param matcher The prepared *query*. Fuzzy matchers do not use the trigram index.
+ * @param num_rows The number of rows to match.
+ * @param visible Function that returns whether or not a given row matches the query. It may be
+ *   called from multiple threads at once.
+ * @param progress Optional function that is periodically passed the rows matched so far. If it
+ *   returns `FALSE`, filtering is cancelled.
+ * @param userdata Userdata to pass to *visible* and *progress*.
+ * @param len Pointer to the number of matching rows, which is set.
+ * @return list of matching rows, in ascending order, or `NULL` if filtering was cancelled. It is
+ *   owned by the filter and remains valid until the filter is used or freed again.
+ */
+int *filter_rows(Filter *filter, const char *query, const Matcher *matcher, int num_rows,
+  int (*visible)(int row, void *userdata),
+  int (*progress)(const int *rows, int len, void *userdata), void *userdata, int *len);
+
+/**
+ * Frees the given filter's items, keys, and results, stopping any indexing first.
+ * Once no initialized filters remain, the worker threads filters match rows on are stopped too.
+ * The filter must be initialized again before being used again.
+ * @param filter The filter.
+ */
+void filter_free(Filter *filter);
+
+/**
+ * Prepares the given matcher for the given case-folded query, whose space-separated tokens must
+ * appear in a key for it to match.
+ * The matcher's *fuzzy* field determines how tokens are matched.
+ * @param matcher The matcher.
+ * @param query The case-folded query.
+ */
+void filter_set_matcher(Matcher *matcher, const char *query);
+
+/**
+ * Returns whether or not the key of the given row matches the given matcher's query.
+ * @param matcher The matcher.
+ * @param keys The search keys of rows.
+ * @param row The row to match.
+ */
+int filter_match(const Matcher *matcher, const Keys *keys, int row);
+
+/**
+ * Frees the given matcher's query.
+ * @param matcher The matcher.
+ */
+void filter_free_matcher(Matcher *matcher);
+
+/**
+ * Orders the given rows that match the given fuzzy matcher best match first.
+ * Only the best 1000 rows are fully sorted, and any other rows follow them in their original
+ * order.
+ * @param matcher The fuzzy matcher the rows match.
+ * @param keys The search keys of rows.
+ * @param rows The rows to order.
+ * @param len The number of rows in *rows*.
+ */
+void filter_rank(const Matcher *matcher, const Keys *keys, int *rows, int len);
+
+/**
+ * Returns a pointer to space for ITEMS_BATCH bytes at the end of the given item reader's buffer
+ * that the next read should be stored in.
+ * @param reader The item reader.
+ */
+char *filter_reader_space(ItemReader *reader);
+
+/**
+ * Passes each complete item read into the given item reader's buffer to its callback function,
+ * and keeps any incomplete item for the next read.
+ * @param reader The item reader.
+ * @param n The number of bytes just read into the space returned by `filter_reader_space()`.
+ * @param eof Whether or not the end of input has been reached. If so, any incomplete item is
+ *   treated as a complete one.
+ */
+void filter_read(ItemReader *reader, size_t n, int eof);
+
+#endif
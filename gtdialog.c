@@ -24,17 +24,37 @@
  * THE SOFTWARE.
  */
 
+#if (CURSES && !_WIN32)
+#define _DEFAULT_SOURCE 1 // for clock_gettime() in strict C99 mode
+#endif
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if __linux__
+#include <libgen.h>
+#include <sys/inotify.h>
+#endif
+#if (CURSES && !_WIN32)
+#include <poll.h>
+#include <time.h>
+#endif
 #if GTK
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
 #include <gdk/gdkkeysyms.h>
+#if (!LIBRARY && !_WIN32)
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
 #elif CURSES
-#include <unistd.h>
 #if (LIBRARY && !_WIN32)
 #include <termios.h>
 #elif _WIN32
@@ -43,20 +63,289 @@
 #include <cdk/cdk.h>
 #endif
 
+#include "filter.h"
 #include "gtdialog.h"
 
 #if GTK
 static GtkWindow *parent;
-static int timeout_source = -1;
 #endif
+// The progressbar callback function, userdata, and stop flag for the next progressbar dialog.
 static char *(*progressbar_cb)(void *);
 static void *progressbar_cb_userdata;
-#if CURSES
-static CDKENTRY *focused_entry;
-#endif
+static int *progressbar_stop_flag;
+// The progress handle for the next progressbar dialog.
+static GTDialogProgress *progressbar_handle;
 static int RESPONSE_DELETE = -1, RESPONSE_TIMEOUT = 0, RESPONSE_CHANGE = 4;
-// Options used by other functions.
-static int indeterminate, stoppable, string_output, output_col = 1, search_col = 1;
+
+/** Progressbar input that has been read but not shown yet. */
+typedef struct {
+  /** Whether or not there is input to show. */
+  int pending;
+  /** The latest percentage. */
+  int percent;
+  /** The latest display text and the allocated size of its buffer. */
+  char *text;
+  size_t text_size;
+  /** Whether or not the display text changed. */
+  int text_changed;
+  /** Whether the "Stop" button was last enabled (1) or disabled (0), or -1 if neither. */
+  int stop;
+} ProgressInput;
+
+/** A task of a multi-task progressbar. */
+typedef struct {
+  /** The task's ID. */
+  char *id;
+  /** The task's latest percentage and display text. */
+  ProgressInput progress;
+  /** The task's row in the dialog, or -1 if it has none. */
+  int row;
+  /** Whether or not the task is queued to be shown. */
+  int queued;
+#if GTK
+  /** The task's progressbar, or `NULL`. */
+  GtkWidget *bar;
+#endif
+} Task;
+
+/** The tasks of a multi-task progressbar. */
+typedef struct {
+  /** A hash table of all tasks by ID, with open addressing, and its size (a power of 2). */
+  Task **table;
+  size_t table_size;
+  /** The number of tasks. */
+  int len;
+  /** The sum of all tasks' percentages. */
+  int64_t sum;
+  /** The tasks with rows in the dialog, in row order, and the allocated size of the list. */
+  Task **rows;
+  int num_rows, rows_size;
+  /** The tasks to show, in the order they changed, and the allocated size of the queue. */
+  Task **queue;
+  int queue_len, queue_size;
+} Tasks;
+
+#if GTK
+#define atomic_get(p) g_atomic_int_get(p)
+#define atomic_set(p, v) g_atomic_int_set(p, v)
+#else
+#define atomic_get(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define atomic_set(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#endif
+
+/** The size of a progress handle's text slots. Longer texts pushed are truncated. */
+#define PROGRESS_TEXT_SIZE 256
+/** The number of a progress handle's text slots. */
+#define PROGRESS_TEXT_SLOTS 16
+/** The flag of a progress handle's latest text slot that marks it as not taken yet. */
+#define PROGRESS_TEXT_NEW 0x100
+
+/**
+ * A progress handle that any thread can push progressbar updates to without allocating memory.
+ * Only the latest update is kept until the progressbar takes it.
+ * Each producer claims a free text slot, writes to it, and swaps it with the latest one, freeing
+ * the slot it replaced. The progressbar swaps the latest slot with the slot it reads from. No
+ * thread ever waits for another one.
+ */
+struct GTDialogProgress {
+  /** The latest percentage pushed, or -1 if it has been taken. It is accessed atomically. */
+  int percent;
+  /** The text slots. */
+  char texts[PROGRESS_TEXT_SLOTS][PROGRESS_TEXT_SIZE];
+  /** The bit set of free slots. It is accessed atomically. */
+  int free_slots;
+  /** The latest slot written, or'd with `PROGRESS_TEXT_NEW` until the progressbar takes it. It is
+   * accessed atomically. */
+  int latest;
+  /** The slot the progressbar reads from. */
+  int front;
+  /** Whether or not work finished, and whether or not the progressbar was stopped or closed. */
+  int finished, stopped;
+};
+
+#if GTK
+#define compare_and_swap(p, old, v) g_atomic_int_compare_and_exchange(p, old, v)
+#else
+#define compare_and_swap(p, old, v) \
+  __atomic_compare_exchange_n(p, &(int){old}, v, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#endif
+/** Atomically replaces the given int with -1 and returns its previous value. */
+static int take_int(int *p) {
+  int value;
+  do
+    value = atomic_get(p);
+  while (value >= 0 && !compare_and_swap(p, value, -1));
+  return value;
+}
+/** Atomically replaces the given int with the given value and returns its previous value. */
+static int swap_int(int *p, int v) {
+  int value;
+  do
+    value = atomic_get(p);
+  while (!compare_and_swap(p, value, v));
+  return value;
+}
+
+/**
+ * Claims one of the given progress handle's free text slots.
+ * @return slot, or -1 if every slot is in use
+ */
+static int claim_text_slot(GTDialogProgress *handle) {
+  int slots, slot;
+  do {
+    if (!(slots = atomic_get(&handle->free_slots))) return -1;
+    for (slot = 0; !(slots & 1 << slot); slot++) {}
+  } while (!compare_and_swap(&handle->free_slots, slots, slots & ~(1 << slot)));
+  return slot;
+}
+
+/** Returns the given text slot to the given progress handle's free slots. */
+static void free_text_slot(GTDialogProgress *handle, int slot) {
+  int slots;
+  do
+    slots = atomic_get(&handle->free_slots);
+  while (!compare_and_swap(&handle->free_slots, slots, slots | 1 << slot));
+}
+
+/** The worker thread a progressbar callback function runs on. */
+typedef struct {
+  /** Whether or not the progressbar was stopped or closed. It is accessed atomically. */
+  int stopped;
+  /** Whether or not the callback function finished. It is accessed atomically. */
+  int finished;
+#if GTK
+  GThread *thread;
+  /** The lock for the progressbar's pending input. */
+  GMutex lock;
+#elif CURSES
+  /** Whether or not the thread is running. If not, the dialog calls the callback itself. */
+  int started;
+#if !_WIN32
+  pthread_t thread;
+  /** The lock for the progressbar's pending input. */
+  pthread_mutex_t lock;
+#endif
+#endif
+} ProgressWorker;
+
+/**
+ * The state of a single dialog that its signal handlers need.
+ * Each dialog has its own so that several dialogs may be shown at once.
+ */
+typedef struct {
+  /** Whether or not the progressbar shows activity rather than a percentage. */
+  int indeterminate;
+  /** Whether or not the progressbar has a "Stop" button. */
+  int stoppable;
+  /** Whether or not to output button labels and items instead of indices. */
+  int string_output;
+  /** The 1-based column of filteredlist items to output. */
+  int output_col;
+  /** The progressbar callback function and its userdata, or `NULL`. */
+  char *(*progressbar_cb)(void *);
+  void *progressbar_cb_userdata;
+  /** The file descriptor read in place of stdin, which the dialog does not close. */
+  int stdin_fd;
+  /** The reader of progressbar input lines. */
+  ItemReader input;
+  /** Progressbar input that has been read but not shown yet. */
+  ProgressInput progress;
+  /** The progressbar callback function's worker thread, or `NULL`. */
+  ProgressWorker *worker;
+  /** The flag to set when the progressbar is stopped or closed, or `NULL`. */
+  int *stop_flag;
+  /** The progress handle the progressbar takes updates from, or `NULL`. */
+  GTDialogProgress *handle;
+  /** The tasks of a multi-task progressbar, or `NULL`. */
+  Tasks *tasks;
+  /** The time progressbar input was last shown. */
+  int64_t redraw_time;
+#if GTK
+  /** The dialog window or native file dialog. */
+  GtkWidget *dialog;
+  /** The ID of the source that times out the dialog, or 0. */
+  guint timeout_source;
+  /** The ID of the source that reads or produces progressbar input, or 0. */
+  guint input_source;
+  /** The progressbar, its "Stop" button, and the box of its tasks' progressbars, or `NULL`. */
+  GtkWidget *progressbar, *stop_button, *task_box;
+  /** The ID of the source that shows pending progressbar input, or 0. */
+  guint redraw_source;
+#elif CURSES
+  /** The entries of a multiple entry inputbox, terminated by `NULL`. */
+  CDKENTRY **entries;
+  /** The entry of a multiple entry inputbox that has focus. */
+  CDKENTRY *focused_entry;
+  /** The progressbar, its display text label, and its "Stop" button box, or `NULL`. */
+  CDKSLIDER *progressbar;
+  CDKLABEL *progress_label;
+  CDKBUTTONBOX *buttonbox;
+  /** The display text label's line, which is padded to the label's width. */
+  char *progress_line;
+  /** The label that shows a multi-task progressbar's tasks, or `NULL`. */
+  CDKLABEL *task_label;
+  /** The task label's lines, their number, and their width. Lines are padded to the width. */
+  char **task_lines;
+  int num_task_lines;
+  size_t task_width;
+  /** Whether or not the "Stop" button is enabled. */
+  int stop_enabled;
+#endif
+} DialogContext;
+
+/** Text streamed into a textbox from stdin or from a followed file as it grows. */
+typedef struct {
+  /** The file descriptor text is read from, or -1 once it is closed. */
+  int fd;
+  /** Whether or not the file descriptor is a file to follow rather than a stream to read. */
+  int follow;
+  /** The path of the followed file, which is reopened if another file replaces it. */
+  const char *path;
+  /** The inotify descriptor that signals changes to the followed file, or -1 to poll it. */
+  int notify_fd;
+  /** The inotify watch of the followed file. */
+  int watch;
+  /** Whether or not the followed file may have changed since it was last read. */
+  int changed;
+  /** Text read but not shown yet, its length, and the allocated size of its buffer. */
+  char *buf;
+  size_t len, size;
+  /** The maximum number of lines the textbox keeps, or 0 for no limit. */
+  int max_lines;
+  /** The time text was last shown. */
+  int64_t redraw_time;
+#if GTK
+  GtkTextView *view;
+  /** Whether or not the textbox follows the end of its text. */
+  int following;
+  /** The IDs of the sources that read text and that show text read, or 0. */
+  guint read_source, redraw_source;
+#elif CURSES
+  CDKMENTRY *view;
+  /** The textbox's text, its length, and the allocated size of its buffer. */
+  char *text;
+  size_t text_len, text_size;
+#endif
+} TextStream;
+
+/** A dialog shown by `gtdialog_async()`. */
+struct GTDialogAsync {
+  GTDialogType type;
+  int narg;
+  /** Copies of the dialog's arguments. */
+  char **args;
+  /** The file descriptor the dialog reads in place of stdin. */
+  int stdin_fd;
+  /** The function to pass the dialog's result to and its userdata. */
+  void (*callback)(char *, void *);
+  void *userdata;
+#if GTK
+  /** The ID of the idle source that shows the dialog, or 0 once it is shown. */
+  guint source;
+  /** The context of the dialog while it is running, or `NULL`. */
+  DialogContext *context;
+#endif
+};
 
 // Default button labels.
 #if GTK
@@ -82,6 +371,7 @@ static int indeterminate, stoppable, string_output, output_col = 1, search_col =
 #endif
 #endif
 #define copy(s) strcpy(malloc(strlen(s) + 1), s)
+#define copyn(s, n) ((char *)memcpy(calloc((n) + 1, 1), s, n))
 
 #if GTK
 void gtdialog_set_parent(GtkWindow *window) { parent = window; }
@@ -91,6 +381,38 @@ void gtdialog_set_progressbar_callback(char *(*f)(void *), void *userdata) {
   progressbar_cb = f, progressbar_cb_userdata = userdata;
 }
 
+void gtdialog_set_progressbar_stop_flag(int *flag) { progressbar_stop_flag = flag; }
+
+GTDialogProgress *gtdialog_progress_new(void) {
+  GTDialogProgress *handle = calloc(1, sizeof(GTDialogProgress));
+  handle->percent = -1, handle->latest = 0, handle->front = 1;
+  handle->free_slots = ((1 << PROGRESS_TEXT_SLOTS) - 1) & ~3; // all but the latest and front slots
+  return (progressbar_handle = handle);
+}
+
+void gtdialog_progress_update(GTDialogProgress *handle, int percent, const char *text) {
+  if (percent >= 0) atomic_set(&handle->percent, percent <= 100 ? percent : 100);
+  if (!text) return;
+  // With every slot in use, as many concurrent updates are newer than this one.
+  int slot = claim_text_slot(handle);
+  if (slot < 0) return;
+  size_t len = strlen(text);
+  if (len >= PROGRESS_TEXT_SIZE)
+    for (len = PROGRESS_TEXT_SIZE - 1; len > 0 && (text[len] & 0xC0) == 0x80; len--) {}
+  char *dest = handle->texts[slot];
+  memcpy(dest, text, len), dest[len] = '\0'; // truncated at a UTF-8 character boundary
+  free_text_slot(handle, swap_int(&handle->latest, slot | PROGRESS_TEXT_NEW) & ~PROGRESS_TEXT_NEW);
+}
+
+void gtdialog_progress_finish(GTDialogProgress *handle) { atomic_set(&handle->finished, TRUE); }
+
+int gtdialog_progress_stopped(GTDialogProgress *handle) { return atomic_get(&handle->stopped); }
+
+void gtdialog_progress_free(GTDialogProgress *handle) {
+  if (progressbar_handle == handle) progressbar_handle = NULL;
+  free(handle);
+}
+
 GTDialogType gtdialog_type(const char *type) {
   if (strcmp(type, "msgbox") == 0)
     return GTDIALOG_MSGBOX;
@@ -130,296 +452,1687 @@ GTDialogType gtdialog_type(const char *type) {
 }
 
 // Callbacks and utility functions.
-#if GTK
-/** Signal for a dropdown selection change. */
-static void close_dropdown(GtkWidget *dropdown, gpointer userdata) {
-  g_signal_emit_by_name(userdata, "response", RESPONSE_CHANGE);
+
+/** The minimum size of a block of arena memory. */
+#define ARENA_BLOCK_SIZE 4096
+
+/** A block of arena memory. */
+typedef struct ArenaBlock {
+  /** The next block, which is older. */
+  struct ArenaBlock *next;
+  /** The number of bytes of *data*. */
+  size_t size;
+  /** The number of bytes of *data* allocated so far. */
+  size_t used;
+  /** The block's memory. */
+  char data[];
+} ArenaBlock;
+
+/**
+ * An arena of scratch memory for a single dialog.
+ * Memory allocated from it is never freed individually, but all at once when the dialog returns.
+ */
+typedef struct {
+  /** The blocks of memory, newest first. */
+  ArenaBlock *blocks;
+  /** The total number of bytes allocated from the arena. */
+  size_t used;
+} Arena;
+
+#if DEBUG
+/** The largest number of bytes allocated from any one dialog's arena. */
+static size_t arena_high_water;
+#endif
+
+/** Returns *size* bytes of memory allocated from the given arena. */
+static void *arena_alloc(Arena *arena, size_t size) {
+  size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1); // keep allocations aligned
+  ArenaBlock *block = arena->blocks;
+  if (!block || block->size - block->used < size) {
+    size_t block_size = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+    block = malloc(sizeof(ArenaBlock) + block_size);
+    block->next = arena->blocks, block->size = block_size, block->used = 0;
+    arena->blocks = block;
+  }
+  void *p = block->data + block->used;
+  block->used += size, arena->used += size;
+  return p;
 }
 
-/** Filters the list. */
-static int filter_list(gpointer userdata) {
-  GtkTreeView *view = GTK_TREE_VIEW(userdata);
-  GtkTreeModel *model = gtk_tree_view_get_model(view);
-  gtk_tree_model_filter_refilter(GTK_TREE_MODEL_FILTER(model));
-  GtkTreeIter iter;
-  if (gtk_tree_model_get_iter_first(model, &iter))
-    gtk_tree_selection_select_iter(gtk_tree_view_get_selection(view), &iter);
-  timeout_source = -1;
-  return FALSE;
+/** Returns a copy of the given string allocated from the given arena. */
+static char *arena_copy(Arena *arena, const char *s) {
+  return strcpy(arena_alloc(arena, strlen(s) + 1), s);
+}
+
+/** Returns a string formatted from the given printf()-style format, allocated from an arena. */
+static char *arena_printf(Arena *arena, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+  char *s = arena_alloc(arena, len + 1);
+  va_start(args, format);
+  vsprintf(s, format, args);
+  va_end(args);
+  return s;
+}
+
+/** Frees all of the memory allocated from the given arena. */
+static void free_arena(Arena *arena) {
+#if DEBUG
+  if (arena->used > arena_high_water) arena_high_water = arena->used;
+  fprintf(stderr, "gtdialog: arena used %lu bytes (high-water mark: %lu bytes)\n",
+    (unsigned long)arena->used, (unsigned long)arena_high_water);
+#endif
+  for (ArenaBlock *block = arena->blocks, *next; block; block = next)
+    next = block->next, free(block);
+  arena->blocks = NULL, arena->used = 0;
+}
+
+/** Returns the current time of a monotonic clock in microseconds. */
+static int64_t monotonic_time(void) {
+#if GTK
+  return g_get_monotonic_time();
+#elif (CURSES && !_WIN32)
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+  return (int64_t)GetTickCount64() * 1000;
+#endif
 }
 
 /**
- * Signal for a keypress in the filteredlist entry.
- * When the list is sufficiently large, filter on a timeout.
+ * The times startup profiling started and the last startup phase ended, or 0 if startup is not
+ * being profiled.
  */
-static gboolean entry_keypress(GtkWidget *entry, GdkEventKey *event, gpointer userdata) {
-  if (timeout_source != -1) g_source_remove(timeout_source);
-  GtkTreeView *view = GTK_TREE_VIEW(userdata);
-  GtkTreeModel *model = gtk_tree_view_get_model(view);
-  if (gtk_tree_model_iter_n_children(model, NULL) > 10000)
-    timeout_source = g_timeout_add(100, filter_list, userdata);
-  else
-    filter_list(userdata);
+static int64_t profile_start, profile_last;
+
+/**
+ * Writes to stderr the time the given startup phase took and the total time so far, if startup
+ * is being profiled.
+ * @param phase The name of the phase that just ended.
+ */
+static void profile_phase(const char *phase) {
+  if (!profile_start) return;
+  int64_t now = monotonic_time();
+  fprintf(stderr, "gtdialog: profile: %-8s %9.3f ms %9.3f ms\n", phase,
+    (now - profile_last) / 1000.0, (now - profile_start) / 1000.0);
+  profile_last = now;
 }
 
+/** The minimum time between progressbar redraws in microseconds, about one display frame. */
+#define REDRAW_INTERVAL 16667
+
 /**
- * Processes input for the progressbar.
+ * Parses a line of progressbar input into the given progressbar input to show.
+ * Only the latest input is kept until the progressbar is redrawn.
  * @param input String of the form "num str\n", where num is integer progress
  *   between 0 and 100 and str is optional progress display text. If the text
  *   is "stop disable" or "stop enable", enables or disables the "Stop" button,
- *   respectively.
+ *   respectively. The trailing '\n' is optional.
+ *   This string will be modified in place.
+ * @param progress The progressbar input to store the line's progress in.
+ * @param stoppable Whether or not the progressbar has a "Stop" button to enable or disable.
+ */
+static void parse_progressbar_input(char *input, ProgressInput *progress, int stoppable) {
+  char *text = input;
+  while (*text && !isspace(*text)) text++;
+  if (*text) *text++ = '\0';
+  size_t len = strlen(text);
+  if (len > 0 && text[len - 1] == '\n') text[--len] = '\0'; // chomp '\n'
+  progress->pending = TRUE, progress->percent = atoi(input);
+  if (!*text) return;
+  if (stoppable && strcmp(text, "stop enable") == 0)
+    progress->stop = TRUE;
+  else if (stoppable && strcmp(text, "stop disable") == 0)
+    progress->stop = FALSE;
+  else {
+    if (len + 1 > progress->text_size)
+      progress->text = realloc(progress->text, progress->text_size = len + 1);
+    memcpy(progress->text, text, len + 1), progress->text_changed = TRUE;
+  }
+}
+
+/** Returns the hash of the given task ID. */
+static size_t hash_task_id(const char *id) {
+  size_t hash = 2166136261u; // FNV-1a
+  while (*id) hash = (hash ^ (unsigned char)*id++) * 16777619u;
+  return hash;
+}
+
+/** Returns the slot of the task with the given ID in the given hash table, or its empty slot. */
+static size_t find_task_slot(Task **table, size_t size, const char *id) {
+  size_t i = hash_task_id(id) & (size - 1);
+  while (table[i] && strcmp(table[i]->id, id) != 0) i = (i + 1) & (size - 1);
+  return i;
+}
+
+/** Returns the given multi-task progressbar's task with the given ID, adding it if necessary. */
+static Task *get_task(Tasks *tasks, const char *id) {
+  if (2 * (size_t)(tasks->len + 1) > tasks->table_size) {
+    // Keep the table at most half full.
+    size_t size = tasks->table_size > 0 ? 2 * tasks->table_size : 64;
+    Task **table = calloc(size, sizeof(Task *));
+    for (size_t i = 0; i < tasks->table_size; i++) {
+      Task *task = tasks->table[i];
+      if (task) table[find_task_slot(table, size, task->id)] = task;
+    }
+    free(tasks->table), tasks->table = table, tasks->table_size = size;
+  }
+  size_t i = find_task_slot(tasks->table, tasks->table_size, id);
+  if (tasks->table[i]) return tasks->table[i];
+  Task *task = tasks->table[i] = calloc(1, sizeof(Task));
+  task->id = copy(id), task->progress.stop = -1, task->row = -1, tasks->len++;
+  return task;
+}
+
+/**
+ * Processes a line of multi-task progressbar input, and updates the overall progress, which is
+ * the average of every task's progress.
+ * @param input String of the form "id num str\n", where id is the ID of the task to update and
+ *   "num str\n" is the task's progressbar input. Tasks are added as they are first seen.
  *   This string will be modified in place.
- * @param userdata Progressbar widget.
+ * @param context The progressbar's DialogContext.
  */
-static void process_progressbar_input(char *input, gpointer userdata) {
-  GtkWidget *dialog = (GtkWidget *)userdata;
-  GtkWidget *box = gtk_dialog_get_content_area(GTK_DIALOG(dialog));
-  GList *children = gtk_container_get_children(GTK_CONTAINER(box));
-  GtkWidget *progressbar = (GtkWidget *)children->data;
+static void process_task_input(char *input, DialogContext *context) {
+  Tasks *tasks = context->tasks;
   char *p = input;
-  while (!isspace(*p)) p++;
-  *p = '\0', p[strlen(p + 1)] = '\0'; // chomp '\n'
-  if (!indeterminate)
-    gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progressbar), 0.01 * atoi(input));
+  while (*p && !isspace(*p)) p++;
+  if (*p) *p++ = '\0';
+  if (!*input) return;
+  Task *task = get_task(tasks, input);
+  int percent = task->progress.percent;
+  parse_progressbar_input(p, &task->progress, context->stoppable);
+  if (task->progress.percent < 0) task->progress.percent = 0;
+  if (task->progress.percent > 100) task->progress.percent = 100;
+  tasks->sum += task->progress.percent - percent;
+  if (task->progress.stop >= 0) // the "Stop" button is not per task
+    context->progress.stop = task->progress.stop, task->progress.stop = -1;
+  if (!task->queued) {
+    if (tasks->queue_len == tasks->queue_size)
+      tasks->queue = realloc(tasks->queue,
+        sizeof(Task *) * (tasks->queue_size = tasks->queue_size > 0 ? 2 * tasks->queue_size : 64));
+    tasks->queue[tasks->queue_len++] = task, task->queued = TRUE;
+  }
+  context->progress.pending = TRUE, context->progress.percent = tasks->sum / tasks->len;
+}
+
+/**
+ * Processes input for the progressbar, which is either a single task's progressbar input or a
+ * multi-task progressbar's input.
+ * @param input The line of input, which will be modified in place.
+ * @param userdata The progressbar's DialogContext.
+ * @see parse_progressbar_input
+ * @see process_task_input
+ */
+static void process_progressbar_input(char *input, void *userdata) {
+  DialogContext *context = (DialogContext *)userdata;
+  if (!context->tasks)
+    parse_progressbar_input(input, &context->progress, context->stoppable);
   else
-    gtk_progress_bar_pulse(GTK_PROGRESS_BAR(progressbar));
-  if (*(p + 1)) {
-    if (stoppable) {
-      box = gtk_dialog_get_action_area(GTK_DIALOG(dialog));
-      GList *children2 = gtk_container_get_children(GTK_CONTAINER(box));
-      GtkWidget *button = (GtkWidget *)children2->data;
-      if (strcmp(p + 1, "stop enable") == 0)
-        gtk_widget_set_sensitive(button, TRUE);
-      else if (strcmp(p + 1, "stop disable") == 0)
-        gtk_widget_set_sensitive(button, FALSE);
-      else
-        gtk_progress_bar_set_text(GTK_PROGRESS_BAR(progressbar), p + 1);
-      g_list_free(children2);
-    } else
-      gtk_progress_bar_set_text(GTK_PROGRESS_BAR(progressbar), p + 1);
+    process_task_input(input, context);
+}
+
+/** Gives the given task of the given multi-task progressbar the next row. */
+static void add_task_row(Tasks *tasks, Task *task) {
+  if (tasks->num_rows == tasks->rows_size)
+    tasks->rows = realloc(tasks->rows,
+      sizeof(Task *) * (tasks->rows_size = tasks->rows_size > 0 ? 2 * tasks->rows_size : 64));
+  task->row = tasks->num_rows, tasks->rows[tasks->num_rows++] = task;
+}
+
+/** Removes the given task's row from the given multi-task progressbar, moving the last row in. */
+static void remove_task_row(Tasks *tasks, Task *task) {
+  Task *last = tasks->rows[--tasks->num_rows];
+  tasks->rows[task->row] = last, last->row = task->row, task->row = -1;
+}
+
+/** Frees the given multi-task progressbar's tasks. */
+static void free_tasks(Tasks *tasks) {
+  for (size_t i = 0; i < tasks->table_size; i++) {
+    Task *task = tasks->table[i];
+    if (task) free(task->id), free(task->progress.text), free(task);
   }
-  g_list_free(children);
+  free(tasks->table), free(tasks->rows), free(tasks->queue), free(tasks);
 }
 
-/** Signal for when stdin is available for the progressbar. */
-static gboolean read_stdin(GIOChannel *channel, GIOCondition condition, gpointer userdata) {
-  GtkWidget *dialog = (GtkWidget *)userdata;
-  if (condition == G_IO_IN) {
-    char *input;
-    if (g_io_channel_read_line(channel, &input, NULL, NULL, NULL) == G_IO_STATUS_NORMAL)
-      process_progressbar_input(input, userdata), free(input);
-  } else
-    g_signal_emit_by_name(dialog, "response", 0); // 1 is for Stop pressed
-  return !(condition & G_IO_HUP);
+/** Locks the given progressbar's pending input if its callback runs on a worker thread. */
+static void lock_progressbar_input(DialogContext *context) {
+#if GTK
+  if (context->worker) g_mutex_lock(&context->worker->lock);
+#elif (CURSES && !_WIN32)
+  if (context->worker && context->worker->started) pthread_mutex_lock(&context->worker->lock);
+#endif
+}
+
+/** Unlocks the given progressbar's pending input. */
+static void unlock_progressbar_input(DialogContext *context) {
+#if GTK
+  if (context->worker) g_mutex_unlock(&context->worker->lock);
+#elif (CURSES && !_WIN32)
+  if (context->worker && context->worker->started) pthread_mutex_unlock(&context->worker->lock);
+#endif
 }
 
 /**
- * Timeout function for calling the progressbar callback function to do some
- * work.
- * @param userdata Progressbar widget.
+ * Calls the given progressbar's callback function once and processes its input.
+ * @return `TRUE` if the callback has more work to do, or `FALSE` if it finished
  */
-static gboolean call_progressbar_callback(gpointer userdata) {
-  if (!progressbar_cb) return FALSE;
-  char *input = progressbar_cb(progressbar_cb_userdata);
-  if (!input) return (g_signal_emit_by_name((GtkWidget *)userdata, "response", 0), FALSE);
-  process_progressbar_input(input, userdata);
-  free(input);
-  while (gtk_events_pending()) gtk_main_iteration();
+static int call_progressbar_callback(DialogContext *context) {
+  char *input = context->progressbar_cb(context->progressbar_cb_userdata);
+  if (!input) return FALSE;
+  lock_progressbar_input(context), process_progressbar_input(input, context);
+  unlock_progressbar_input(context), free(input);
   return TRUE;
 }
 
 /**
- * Function for iterating over filteredlist selections.
- * Concatenates all selections into a single string delimited by newline
- * characters.
+ * Thread function for calling the progressbar callback function until it finishes or the
+ * progressbar is stopped.
+ * @param userdata The progressbar's DialogContext.
  */
-static void list_foreach(
-  GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, gpointer userdata) {
-  char *value;
-  if (!string_output) {
-    GtkTreeModelFilter *filter = GTK_TREE_MODEL_FILTER(model);
-    path = gtk_tree_model_filter_convert_path_to_child_path(filter, path);
-    value = gtk_tree_path_to_string(path);
-    gtk_tree_path_free(path);
-  } else
-    gtk_tree_model_get(model, iter, output_col - 1, &value, -1);
-  g_string_append_printf((GString *)userdata, "%s\n", value);
-  free(value);
+static void *run_progressbar_callback(void *userdata) {
+  DialogContext *context = (DialogContext *)userdata;
+  ProgressWorker *worker = context->worker;
+  while (!atomic_get(&worker->stopped) && call_progressbar_callback(context)) {}
+  return (atomic_set(&worker->finished, TRUE), NULL);
 }
 
-/** Signal for the 'enter' key being pressed in the filteredlist view. */
-static gboolean list_keypress(GtkWidget *treeview, GdkEventKey *event, gpointer userdata) {
-  if (event->keyval == 0xff0d) // return key
-    return (g_signal_emit_by_name(userdata, "response", 1), TRUE);
-  return FALSE;
+/**
+ * Starts calling the given progressbar's callback function on a worker thread, so slow work does
+ * not keep the dialog from responding.
+ * Without threads, the dialog calls the callback itself between redraws.
+ */
+static void start_progressbar_worker(DialogContext *context) {
+  ProgressWorker *worker = context->worker = calloc(1, sizeof(ProgressWorker));
+#if GTK
+  g_mutex_init(&worker->lock);
+  worker->thread = g_thread_new("progressbar", run_progressbar_callback, context);
+#elif (CURSES && !_WIN32)
+  pthread_mutex_init(&worker->lock, NULL);
+  worker->started = pthread_create(&worker->thread, NULL, run_progressbar_callback, context) == 0;
+#endif
 }
 
-/** Signal for a row being activated in the filteredlist view. */
-static gboolean list_select(
-  GtkTreeView *treeview, GtkTreePath *path, GtkTreeViewColumn *column, gpointer userdata) {
-  return (g_signal_emit_by_name(userdata, "response", 1), TRUE);
+/**
+ * Returns whether or not the given progressbar's callback function finished.
+ * If it has no worker thread, the callback is called once first.
+ */
+static int progressbar_worker_finished(DialogContext *context) {
+  ProgressWorker *worker = context->worker;
+#if CURSES
+  if (!worker->started && !worker->finished && !call_progressbar_callback(context))
+    worker->finished = TRUE;
+#endif
+  return atomic_get(&worker->finished);
 }
 
-/** Function for filtering filterdlist items based on user input. */
-static gboolean list_visible(GtkTreeModel *model, GtkTreeIter *iter, gpointer userdata) {
-  const char *entry_text = gtk_entry_get_text(GTK_ENTRY(userdata));
-  if (strlen(entry_text) == 0) return TRUE;
-  char *text = g_utf8_strdown(entry_text, -1);
-  char *value, *lower, *p;
-  gtk_tree_model_get(model, iter, search_col - 1, &value, -1);
-  if (!value) return TRUE; // no data yet
-  lower = g_utf8_strdown(value, -1), p = lower;
-  char **tokens = g_strsplit(text, " ", 0);
-  gboolean visible = TRUE;
-  int i = 0;
-  while (tokens[i] != NULL) {
-    if (!(p = strstr(p, tokens[i]))) {
-      visible = FALSE;
-      break;
-    }
-    p += strlen(tokens[i++]);
-  }
-  free(text), free(value), free(lower);
-  g_strfreev(tokens);
-  return visible;
+/**
+ * Stops the given progressbar's worker thread, and waits for the callback function's current
+ * call to return.
+ * The callback is told it was stopped through the progressbar's stop flag, if any.
+ */
+static void stop_progressbar_worker(DialogContext *context) {
+  ProgressWorker *worker = context->worker;
+  atomic_set(&worker->stopped, TRUE);
+  if (context->stop_flag && !atomic_get(&worker->finished)) atomic_set(context->stop_flag, TRUE);
+#if GTK
+  g_thread_join(worker->thread), g_mutex_clear(&worker->lock);
+#elif (CURSES && !_WIN32)
+  if (worker->started) pthread_join(worker->thread, NULL);
+  pthread_mutex_destroy(&worker->lock);
+#endif
+  free(worker), context->worker = NULL;
 }
 
-/** Signal for a dialog timeout. */
-static gboolean timeout_dialog(gpointer userdata) {
-  return (g_signal_emit_by_name(userdata, "response", RESPONSE_TIMEOUT), FALSE);
-}
-#elif CURSES
 /**
- * Returns the number of lines the given string occupies when wrapped to fit the
- * given number of characters per line and sets the given pointer to the wrapped
- * set of lines.
- * The pointer itself must be freed when finished; do not free its contents.
- * @param str The string to wrap. It is modified in place.
- * @param w The number of characters per line to wrap at.
- * @param plines An empty pointer that will ultimately contain the set of
- *   wrapped lines.
- * @return int number of wrapped lines
+ * Takes the latest updates pushed to the given progressbar's progress handle as its pending
+ * input, discarding older ones.
+ * @return `TRUE` if work finished, or `FALSE` if there may be more updates
  */
-static int wrap(char *str, int w, char ***plines) {
-  // Wrap lines by replacing spaces with '\n' at the appropriate locations.
-  int len = strlen(str);
-  for (int i = w; i < len; i += w) {
-    int j = i;
-    while (j >= 0 && !isspace(str[j])) j--;
-    if (j + w > i) i = j, str[i++] = '\n'; // line length < w; cut here
-  }
-  // Count the number of '\n's to get the number of wrapped lines.
-  int nlines = 1;
-  char *p = str - 1;
-  while ((p = strstr(p + 1, "\n"))) nlines++;
-  // Create the list of lines.
-  char **lines = malloc(nlines * sizeof(char *));
-  lines[0] = str;
-  for (int i = 1; i < nlines; i++) {
-    p = strstr(lines[i - 1], "\n"), *p = '\0';
-    lines[i] = p + 1;
+static int take_progress_updates(DialogContext *context) {
+  GTDialogProgress *handle = context->handle;
+  ProgressInput *progress = &context->progress;
+  int finished = atomic_get(&handle->finished), percent = take_int(&handle->percent);
+  if (percent >= 0) progress->pending = TRUE, progress->percent = percent;
+  if (atomic_get(&handle->latest) & PROGRESS_TEXT_NEW) {
+    handle->front = swap_int(&handle->latest, handle->front) & ~PROGRESS_TEXT_NEW;
+    const char *text = handle->texts[handle->front];
+    size_t len = strlen(text);
+    if (len + 1 > progress->text_size)
+      progress->text = realloc(progress->text, progress->text_size = len + 1);
+    memcpy(progress->text, text, len + 1);
+    progress->pending = progress->text_changed = TRUE;
   }
-  *plines = lines;
-  return nlines;
+  return finished;
 }
 
-/** Signal for the 'tab' and 'shift+tab' keys being pressed. */
-static int entries_tab(EObjectType cdkType, void *object, void *data, chtype key) {
-  CDKENTRY *entry = (CDKENTRY *)object, **entries = (CDKENTRY **)data;
-  int i = 0, len = 0;
-  for (len = 0; entries[len]; len++)
-    if (entries[len] == entry) i = len;
-  if (key == KEY_TAB || key == KEY_DOWN)
-    focused_entry = entries[i + 1];
-  else
-    focused_entry = (i > 0) ? entries[i - 1] : entries[len - 1];
-  return (injectCDKEntry(entry, KEY_ENTER), TRUE);
+/** Tells the given progressbar's progress handle's producers whether the dialog was stopped. */
+static void stop_progress_updates(DialogContext *context) {
+  if (!atomic_get(&context->handle->finished)) atomic_set(&context->handle->stopped, TRUE);
 }
 
-/** Signal for the 'tab' and 'shift+tab' keys being pressed. */
-static int buttonbox_tab(EObjectType cdkType, void *object, void *data, chtype key) {
-  return (injectCDKButtonbox((CDKBUTTONBOX *)data, key), TRUE);
+/** Returns whether or not the given file descriptor has input that can be read without blocking. */
+static int fd_ready(int fd) {
+#if (GTK && !_WIN32)
+  GPollFD pfd = {fd, G_IO_IN, 0};
+  return g_poll(&pfd, 1, 0) > 0;
+#elif (CURSES && !_WIN32)
+  struct pollfd pfd = {fd, POLLIN, 0};
+  return poll(&pfd, 1, 0) > 0;
+#else
+  return FALSE; // assume reading again would block
+#endif
 }
 
-/** The curses filteredlist model. */
-typedef struct {
-  /** The number of columns. */
-  int ncols;
-  /** The index of the column to filter against. */
-  int search_col;
-  /** The raw list of items. */
-  char **items;
-  /** The raw number of items. */
-  int len;
-  /**
-   * The list of display rows.
-   * The contents of each row are constructed from *items* and *ncols* and
-   * suitable for display to the user.
-   */
-  char **rows;
-  /** The number of display rows. */
-  int num_rows;
-  /** The list of filtered rows to actually display. */
-  char **filtered_rows;
-  /** The CDKENTRY the model is assigned to. */
-  CDKENTRY *entry;
-  /** CDKSCROLL the model is assigned to. */
-  CDKSCROLL *scrolled;
-} Model;
+/**
+ * Reads batches of input from the given file descriptor for as long as more is ready.
+ * Reading stops after a while so a producer that never pauses cannot starve the dialog.
+ * @param fd The file descriptor to read from. It should have input available.
+ * @param read_batch Function that reads a batch of input from *fd* and returns `FALSE` if the
+ *   end of input has been reached, `TRUE` otherwise.
+ * @param userdata Userdata to pass to *read_batch*.
+ * @return `FALSE` if the end of input has been reached, `TRUE` otherwise
+ */
+static int read_ready(int fd, int (*read_batch)(void *userdata), void *userdata) {
+  for (int i = 0; i < 16; i++)
+    if (!read_batch(userdata))
+      return FALSE;
+    else if (!fd_ready(fd))
+      break;
+  return TRUE;
+}
 
 /**
- * Returns a copy of the given string converted to lower case.
- * The returned string must be freed when finished.
- * @param s The given string to lowercase. It may be freed immediately.
+ * Reads the next batch of progressbar input lines from stdin.
+ * @param userdata The progressbar's DialogContext.
+ * @return FALSE if the end of input has been reached, TRUE otherwise.
  */
-static char *strdown(char *s) {
-  char *lower = copy(s);
-  int len = strlen(s);
-  for (int i = 0; i < len; i++) lower[i] = tolower(s[i]);
-  return lower;
+static int read_progressbar_input(void *userdata) {
+  DialogContext *context = (DialogContext *)userdata;
+  int n = read(context->stdin_fd, filter_reader_space(&context->input), ITEMS_BATCH);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return TRUE;
+  int eof = n <= 0;
+  filter_read(&context->input, !eof ? n : 0, eof);
+  return !eof;
 }
 
-/** Signal for a keypress in the filteredlist entry. */
-static int entry_keypress(EObjectType cdkType, void *object, void *data, chtype key) {
-  Model *model = (Model *)data;
-  char *entry_text = getCDKEntryValue((CDKENTRY *)object);
-  if (strlen(entry_text) > 0) {
-    char *text = strdown(entry_text), **tokens = CDKsplitString(text, ' ');
-    int row = 0;
-    for (int i = 0; i < model->len; i += model->ncols) {
-      char *item = strdown(model->items[i + model->search_col - 1]), *p = item;
-      int visible = TRUE;
-      for (int j = 0; tokens[j]; j++) {
-        if (!(p = strstr(p, tokens[j]))) {
-          visible = FALSE;
-          break;
-        }
-        p += strlen(tokens[j]);
-      }
-      if (visible) model->filtered_rows[row++] = model->rows[i / model->ncols];
-      free(item);
-    }
-    free(text);
-    CDKfreeStrings(tokens);
-    setCDKScrollItems(model->scrolled, model->filtered_rows, row, FALSE);
-  } else
-    setCDKScrollItems(model->scrolled, model->rows, model->len / model->ncols, FALSE);
-  HasFocusObj(ObjOf(model->scrolled)) = TRUE; // needed to draw highlight
-  eraseCDKScroll(model->scrolled); // drawCDKScroll does not completely redraw
-  drawCDKScroll(model->scrolled, TRUE), drawCDKEntry(model->entry, FALSE);
-  HasFocusObj(ObjOf(model->scrolled)) = FALSE;
+/** The time between checks of an unwatched followed file for new text in milliseconds. */
+#define FOLLOW_INTERVAL 250
+
+#if __linux__
+/** The inotify events of a followed file that may mean it grew, shrank, or was rotated away. */
+#define FOLLOW_EVENTS (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+#endif
+
+/** Returns the offset of the start of the given number of last lines in the given text. */
+static size_t last_lines(const char *text, size_t len, int n) {
+  if (len > 0 && text[len - 1] == '\n') len--; // a trailing '\n' does not start another line
+  for (size_t i = len; i > 0; i--)
+    if (text[i - 1] == '\n' && --n == 0) return i;
+  return 0;
+}
+
+/**
+ * Opens the given textbox stream to follow a file.
+ * @param stream The stream to open.
+ * @param path The path of the file to follow.
+ * @return `FALSE` if the file cannot be opened, `TRUE` otherwise.
+ */
+static int open_text_stream(TextStream *stream, const char *path) {
+  if ((stream->fd = open(path, O_RDONLY)) < 0) return FALSE;
+  stream->follow = TRUE, stream->path = path;
+#if __linux__
+  // Also watch the file's directory for a file that replaces it, as after log rotation.
+  char *copy = strcpy(malloc(strlen(path) + 1), path), *dir = dirname(copy); // may return "."
+  if ((stream->notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) >= 0 &&
+    ((stream->watch = inotify_add_watch(stream->notify_fd, path, FOLLOW_EVENTS)) < 0 ||
+      inotify_add_watch(stream->notify_fd, dir, IN_CREATE | IN_MOVED_TO) < 0))
+    close(stream->notify_fd), stream->notify_fd = -1; // poll instead
+  free(copy);
+#endif
   return TRUE;
 }
 
-// Does not exist on _WIN32, but exists on other platforms with or without
-// feature test macros. Just define as a macro anyway.
-#define stpcpy_(d, s) (strcpy(d, s), d + strlen(s))
+/**
+ * Returns whether or not another file has replaced the given textbox stream's followed file at
+ * its path, as after log rotation.
+ */
+static int text_stream_replaced(TextStream *stream) {
+  struct stat st, path_st;
+  return stream->follow && stat(stream->path, &path_st) == 0 && fstat(stream->fd, &st) == 0 &&
+    (path_st.st_ino != st.st_ino || path_st.st_dev != st.st_dev);
+}
 
-#if !HAVE_CDKUTF8
-/** Returns the number of bytes in the given UTF-8 character. */
-static unsigned int utf8charlen(unsigned char ch) {
-  if (ch < 0x80)
-    return 1;
+/**
+ * Follows the file that replaced the given textbox stream's followed file at its path.
+ * @return `FALSE` if that file cannot be opened yet, `TRUE` otherwise.
+ */
+static int reopen_text_stream(TextStream *stream) {
+  int fd = open(stream->path, O_RDONLY);
+  if (fd < 0) return FALSE;
+  close(stream->fd), stream->fd = fd;
+#if __linux__
+  if (stream->notify_fd >= 0) {
+    inotify_rm_watch(stream->notify_fd, stream->watch);
+    stream->watch = inotify_add_watch(stream->notify_fd, stream->path, FOLLOW_EVENTS);
+  }
+#endif
+  return TRUE;
+}
+
+/**
+ * Reads text from the given textbox stream into its buffer.
+ * A stream is read once, so it should have input available. A followed file is read up to its
+ * current end if it changed, from its start again if it was truncated, and from the start of the
+ * file that replaced it if it was rotated.
+ * Only the last lines the textbox keeps are buffered, so memory stays bounded when there is a
+ * limit.
+ * @return `FALSE` if the end of a stream that is not followed has been reached, `TRUE` otherwise.
+ */
+static int read_text_stream(TextStream *stream) {
+  if (stream->fd < 0) return FALSE;
+  if (stream->notify_fd >= 0) {
+    char events[4096];
+    while (read(stream->notify_fd, events, sizeof(events)) > 0) stream->changed = TRUE;
+    if (!stream->changed) return TRUE;
+    stream->changed = FALSE;
+  }
+  int replaced = text_stream_replaced(stream);
+  struct stat st;
+  if (stream->follow && fstat(stream->fd, &st) == 0 && st.st_size < lseek(stream->fd, 0, SEEK_CUR))
+    lseek(stream->fd, 0, SEEK_SET);
+  int n, interrupted;
+  do {
+    if (stream->len + ITEMS_BATCH > stream->size)
+      stream->buf = realloc(stream->buf, stream->size = 2 * stream->len + ITEMS_BATCH);
+    if ((n = read(stream->fd, stream->buf + stream->len, ITEMS_BATCH)) > 0) stream->len += n;
+    interrupted = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+    size_t start = stream->max_lines ? last_lines(stream->buf, stream->len, stream->max_lines) : 0;
+    if (start > 0) memmove(stream->buf, stream->buf + start, stream->len -= start);
+  } while (stream->follow && n == ITEMS_BATCH);
+  // Read the rest of a replaced file before reading the file that replaced it from its start.
+  if (replaced && reopen_text_stream(stream))
+    return (stream->changed = TRUE, read_text_stream(stream));
+  if (n > 0 || interrupted || stream->follow) return TRUE; // try again later if interrupted
+  return (stream->fd = -1, FALSE); // leave stdin open
+}
+
+/** Stops the given textbox stream and frees its buffers. */
+static void close_text_stream(TextStream *stream) {
+#if GTK
+  if (stream->read_source) g_source_remove(stream->read_source), stream->read_source = 0;
+  if (stream->redraw_source) g_source_remove(stream->redraw_source), stream->redraw_source = 0;
+#elif CURSES
+  if (stream->text) free(stream->text);
+#endif
+  if (stream->follow) close(stream->fd); // leave stdin open
+  if (stream->notify_fd >= 0) close(stream->notify_fd);
+  if (stream->buf) free(stream->buf);
+}
+
+#if GTK
+/** Signal for a dropdown selection change. */
+static void close_dropdown(GtkWidget *dropdown, gpointer userdata) {
+  g_signal_emit_by_name(userdata, "response", RESPONSE_CHANGE);
+}
+
+/**
+ * Shows the given multi-task progressbar's changed tasks, adding rows for tasks that started and
+ * removing rows of tasks that finished.
+ */
+static void show_tasks(DialogContext *context) {
+  Tasks *tasks = context->tasks;
+  for (int i = 0; i < tasks->queue_len; i++) {
+    Task *task = tasks->queue[i];
+    task->queued = FALSE;
+    if (task->progress.percent == 100) {
+      if (task->row < 0) continue;
+      gtk_widget_destroy(task->bar), task->bar = NULL;
+      remove_task_row(tasks, task);
+      continue;
+    }
+    if (task->row < 0) {
+      add_task_row(tasks, task), task->bar = gtk_progress_bar_new();
+#if GTK_CHECK_VERSION(3, 0, 0)
+      gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(task->bar), TRUE);
+#endif
+      gtk_box_pack_start(GTK_BOX(context->task_box), task->bar, FALSE, TRUE, 2);
+      gtk_widget_show(task->bar), task->progress.text_changed = TRUE;
+    }
+    GtkProgressBar *bar = GTK_PROGRESS_BAR(task->bar);
+    gtk_progress_bar_set_fraction(bar, 0.01 * task->progress.percent);
+    if (task->progress.text_changed) {
+      const char *text = task->progress.text ? task->progress.text : "";
+      char *label = g_strconcat(task->id, ": ", text, NULL);
+      gtk_progress_bar_set_text(bar, label), g_free(label);
+      task->progress.text_changed = FALSE;
+    }
+  }
+  tasks->queue_len = 0;
+}
+
+/** Shows the given progressbar's pending input, if any. */
+static void show_progressbar_input(DialogContext *context) {
+  ProgressInput *progress = &context->progress;
+  if (!progress->pending) return;
+  if (context->tasks) show_tasks(context);
+  GtkProgressBar *progressbar = GTK_PROGRESS_BAR(context->progressbar);
+  if (!context->indeterminate)
+    gtk_progress_bar_set_fraction(progressbar, 0.01 * progress->percent);
+  else
+    gtk_progress_bar_pulse(progressbar);
+  if (progress->text_changed) gtk_progress_bar_set_text(progressbar, progress->text);
+  if (progress->stop >= 0) gtk_widget_set_sensitive(context->stop_button, progress->stop);
+  progress->pending = progress->text_changed = FALSE, progress->stop = -1;
+  context->redraw_time = g_get_monotonic_time();
+}
+
+/**
+ * Timeout function for showing pending progressbar input.
+ * @param userdata The progressbar's DialogContext.
+ */
+static gboolean redraw_progressbar(gpointer userdata) {
+  DialogContext *context = (DialogContext *)userdata;
+  context->redraw_source = 0;
+  return (show_progressbar_input(context), FALSE);
+}
+
+/**
+ * Shows the given progressbar's pending input once at least one redraw interval has passed
+ * since input was last shown.
+ */
+static void queue_progressbar_redraw(DialogContext *context) {
+  if (!context->progress.pending || context->redraw_source) return;
+  int64_t wait = context->redraw_time + REDRAW_INTERVAL - g_get_monotonic_time();
+  context->redraw_source = g_timeout_add(wait > 0 ? wait / 1000 : 0, redraw_progressbar, context);
+}
+
+/** Signal for the dialog's first draw when profiling startup. */
+static gboolean profile_draw(GtkWidget *widget, gpointer event, gpointer userdata) {
+  profile_phase("draw");
+  g_signal_handlers_disconnect_by_func(widget, G_CALLBACK(profile_draw), userdata);
+  return FALSE;
+}
+
+/**
+ * Timeout function for showing the latest updates pushed to the progressbar's progress handle,
+ * and for closing the progressbar once work finishes.
+ * @param userdata The progressbar's DialogContext.
+ */
+static gboolean show_progress_updates(gpointer userdata) {
+  DialogContext *context = (DialogContext *)userdata;
+  int finished = take_progress_updates(context);
+  show_progressbar_input(context);
+  if (!finished) return TRUE;
+  context->input_source = 0;
+  return (g_signal_emit_by_name(context->dialog, "response", 0), FALSE); // 1 is for Stop pressed
+}
+
+/**
+ * Signal for when stdin is available for the progressbar.
+ * All available input is read so producers never wait on a full pipe, but only the latest input
+ * is shown, at most once per redraw interval.
+ * @param userdata The progressbar's DialogContext.
+ */
+static gboolean read_stdin(GIOChannel *channel, GIOCondition condition, gpointer userdata) {
+  DialogContext *context = (DialogContext *)userdata;
+  int eof =
+    !(condition & G_IO_IN) || !read_ready(context->stdin_fd, read_progressbar_input, context);
+  if (!(condition & G_IO_IN)) filter_read(&context->input, 0, TRUE);
+  if (!eof) return (queue_progressbar_redraw(context), TRUE);
+  context->input_source = 0;
+  return (g_signal_emit_by_name(context->dialog, "response", 0), FALSE); // 1 is for Stop pressed
+}
+
+/**
+ * Timeout function for showing the latest input from the progressbar callback function's worker
+ * thread, and for closing the progressbar once the callback finishes.
+ * @param userdata The progressbar's DialogContext.
+ */
+static gboolean show_progressbar_worker_input(gpointer userdata) {
+  DialogContext *context = (DialogContext *)userdata;
+  lock_progressbar_input(context), show_progressbar_input(context);
+  unlock_progressbar_input(context);
+  if (!progressbar_worker_finished(context)) return TRUE;
+  context->input_source = 0;
+  return (g_signal_emit_by_name(context->dialog, "response", 0), FALSE); // 1 is for Stop pressed
+}
+
+/**
+ * The GTK filteredlist model.
+ * It is a flat list of visible row indices into a table of items. Each row has one string column
+ * per item column, followed by an integer column that holds the row's index.
+ * While the list of visible rows is being replaced, the model is the applied prefix of the new
+ * list followed by the unvisited suffix of the old list.
+ */
+typedef struct {
+  GObject parent;
+  /** The items rows are made from. */
+  Items *items;
+  /** The number of columns in a row. */
+  int ncols;
+  /** The indices of visible rows, in order. */
+  int *rows;
+  /** The number of visible rows. */
+  int len;
+  /** The allocated number of *rows*. */
+  int size;
+  /** The previous list of visible rows while it is being replaced, or NULL. */
+  int *old_rows;
+  /** The index of the first row in *old_rows* that is still part of the model. */
+  int old_start;
+  /** The number of rows in *old_rows*. */
+  int old_len;
+  /** The stamp of valid iterators. */
+  int stamp;
+} ListModel;
+
+typedef struct {
+  GObjectClass parent_class;
+} ListModelClass;
+
+static void list_model_tree_model_init(GtkTreeModelIface *iface);
+G_DEFINE_TYPE_WITH_CODE(ListModel, list_model, G_TYPE_OBJECT,
+  G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL, list_model_tree_model_init))
+#define LIST_MODEL(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj), list_model_get_type(), ListModel))
+
+/** Returns the number of rows in the given filteredlist model. */
+static int list_model_len(ListModel *model) {
+  return model->len + (model->old_rows ? model->old_len - model->old_start : 0);
+}
+
+/** Returns the index of the row at the given position in the given filteredlist model. */
+static int list_model_row(ListModel *model, int i) {
+  return (i < model->len) ? model->rows[i] : model->old_rows[model->old_start + i - model->len];
+}
+
+/** Returns the index of the row the given filteredlist model iterator points to. */
+#define list_model_iter_row(model, iter) \
+  list_model_row(LIST_MODEL(model), GPOINTER_TO_INT((iter)->user_data))
+
+/** Points the given iterator at the given position in the given filteredlist model. */
+static gboolean list_model_iter(ListModel *model, GtkTreeIter *iter, int i) {
+  if (i < 0 || i >= list_model_len(model)) return (iter->stamp = 0, FALSE);
+  iter->stamp = model->stamp, iter->user_data = GINT_TO_POINTER(i);
+  return TRUE;
+}
+
+static GtkTreeModelFlags list_model_get_flags(GtkTreeModel *model) {
+  return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint list_model_get_n_columns(GtkTreeModel *model) { return LIST_MODEL(model)->ncols + 1; }
+
+static GType list_model_get_column_type(GtkTreeModel *model, gint column) {
+  return (column < LIST_MODEL(model)->ncols) ? G_TYPE_STRING : G_TYPE_INT;
+}
+
+static gboolean list_model_get_iter(GtkTreeModel *model, GtkTreeIter *iter, GtkTreePath *path) {
+  if (gtk_tree_path_get_depth(path) != 1) return (iter->stamp = 0, FALSE);
+  return list_model_iter(LIST_MODEL(model), iter, gtk_tree_path_get_indices(path)[0]);
+}
+
+static GtkTreePath *list_model_get_path(GtkTreeModel *model, GtkTreeIter *iter) {
+  return gtk_tree_path_new_from_indices(GPOINTER_TO_INT(iter->user_data), -1);
+}
+
+static void list_model_get_value(
+  GtkTreeModel *model, GtkTreeIter *iter, gint column, GValue *value) {
+  ListModel *list = LIST_MODEL(model);
+  int row = list_model_iter_row(model, iter), i = row * list->ncols + column;
+  if (column == list->ncols)
+    g_value_init(value, G_TYPE_INT), g_value_set_int(value, row);
+  else {
+    g_value_init(value, G_TYPE_STRING);
+    if (i < list->items->len)
+      g_value_take_string(value, g_strndup(item_text(list->items, i), item_len(list->items, i)));
+  }
+}
+
+static gboolean list_model_iter_next(GtkTreeModel *model, GtkTreeIter *iter) {
+  return list_model_iter(LIST_MODEL(model), iter, GPOINTER_TO_INT(iter->user_data) + 1);
+}
+
+static gboolean list_model_iter_children(
+  GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent) {
+  return !parent ? list_model_iter(LIST_MODEL(model), iter, 0) : (iter->stamp = 0, FALSE);
+}
+
+static gboolean list_model_iter_has_child(GtkTreeModel *model, GtkTreeIter *iter) {
+  return FALSE;
+}
+
+static gint list_model_iter_n_children(GtkTreeModel *model, GtkTreeIter *iter) {
+  return !iter ? list_model_len(LIST_MODEL(model)) : 0;
+}
+
+static gboolean list_model_iter_nth_child(
+  GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent, gint n) {
+  return !parent ? list_model_iter(LIST_MODEL(model), iter, n) : (iter->stamp = 0, FALSE);
+}
+
+static gboolean list_model_iter_parent(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *child) {
+  return (iter->stamp = 0, FALSE);
+}
+
+static void list_model_tree_model_init(GtkTreeModelIface *iface) {
+  iface->get_flags = list_model_get_flags;
+  iface->get_n_columns = list_model_get_n_columns;
+  iface->get_column_type = list_model_get_column_type;
+  iface->get_iter = list_model_get_iter;
+  iface->get_path = list_model_get_path;
+  iface->get_value = list_model_get_value;
+  iface->iter_next = list_model_iter_next;
+  iface->iter_children = list_model_iter_children;
+  iface->iter_has_child = list_model_iter_has_child;
+  iface->iter_n_children = list_model_iter_n_children;
+  iface->iter_nth_child = list_model_iter_nth_child;
+  iface->iter_parent = list_model_iter_parent;
+}
+
+static void list_model_finalize(GObject *object) {
+  ListModel *model = LIST_MODEL(object);
+  free(model->rows), free(model->old_rows);
+  G_OBJECT_CLASS(list_model_parent_class)->finalize(object);
+}
+
+static void list_model_class_init(ListModelClass *klass) {
+  G_OBJECT_CLASS(klass)->finalize = list_model_finalize;
+}
+
+static void list_model_init(ListModel *model) { model->stamp = g_random_int(); }
+
+/**
+ * Creates and returns a new, empty filteredlist model.
+ * @param items The items rows are made from.
+ * @param ncols The number of columns in a row.
+ */
+static ListModel *list_model_new(Items *items, int ncols) {
+  ListModel *model = g_object_new(list_model_get_type(), NULL);
+  model->items = items, model->ncols = ncols;
+  return model;
+}
+
+/** Appends the given row to the given filteredlist model's visible rows. */
+static void list_model_append(ListModel *model, int row) {
+  if (model->len == model->size) {
+    model->size = (model->size > 0) ? 2 * model->size : 1024;
+    model->rows = realloc(model->rows, sizeof(int) * model->size);
+  }
+  model->rows[model->len++] = row;
+  GtkTreeIter iter;
+  list_model_iter(model, &iter, model->len - 1);
+  GtkTreePath *path = gtk_tree_path_new_from_indices(model->len - 1, -1);
+  gtk_tree_model_row_inserted(GTK_TREE_MODEL(model), path, &iter);
+  gtk_tree_path_free(path);
+}
+
+/**
+ * Returns the number of rows that differ between the given filteredlist model's visible rows and
+ * the given list of visible rows.
+ * Both lists are in ascending order.
+ */
+static int list_model_changes(ListModel *model, int *rows, int len) {
+  int changes = 0, i = 0, j = 0;
+  while (i < model->len || j < len)
+    if (i < model->len && j < len && model->rows[i] == rows[j])
+      i++, j++;
+    else if (i < model->len && (j == len || model->rows[i] < rows[j]))
+      i++, changes++;
+    else
+      j++, changes++;
+  return changes;
+}
+
+/**
+ * Replaces the given filteredlist model's visible rows with the given ones, which the model takes
+ * ownership of.
+ * Unless *reset* is TRUE, only the rows that differ between the two lists are deleted or inserted,
+ * so views keep their selections and scroll positions. Otherwise the model should not be attached
+ * to any views, as it emits no signals at all.
+ * @param model The filteredlist model.
+ * @param rows The new list of visible rows, in ascending order.
+ * @param len The number of rows in *rows*.
+ * @param size The allocated number of *rows*.
+ * @param reset Whether or not to replace the rows without emitting any signals.
+ */
+static void list_model_set_rows(ListModel *model, int *rows, int len, int size, int reset) {
+  model->old_rows = model->rows, model->old_start = 0, model->old_len = model->len;
+  model->rows = rows, model->len = reset ? len : 0, model->size = size, model->stamp++;
+  GtkTreeIter iter;
+  while (!reset && (model->len < len || model->old_start < model->old_len)) {
+    int old_row = (model->old_start < model->old_len) ? model->old_rows[model->old_start] : -1;
+    if (model->len < len && old_row == rows[model->len])
+      model->len++, model->old_start++; // unchanged
+    else if (old_row != -1 && (model->len == len || old_row < rows[model->len])) {
+      model->old_start++;
+      GtkTreePath *path = gtk_tree_path_new_from_indices(model->len, -1);
+      gtk_tree_model_row_deleted(GTK_TREE_MODEL(model), path);
+      gtk_tree_path_free(path);
+    } else {
+      list_model_iter(model, &iter, model->len++);
+      GtkTreePath *path = gtk_tree_path_new_from_indices(model->len - 1, -1);
+      gtk_tree_model_row_inserted(GTK_TREE_MODEL(model), path, &iter);
+      gtk_tree_path_free(path);
+    }
+  }
+  free(model->old_rows), model->old_rows = NULL;
+}
+
+/**
+ * The number of microseconds a filter may take before filters run in the background instead of
+ * blocking the UI.
+ */
+#define LIST_FILTER_SYNC_MAX 16000
+/** The number of microseconds between showing partial results of background filters. */
+#define LIST_FILTER_REPORT_INTERVAL 50000
+
+/** The GTK filteredlist. */
+typedef struct {
+  /** The filteredlist's entry. */
+  GtkEntry *entry;
+  /** The filteredlist's view. */
+  GtkTreeView *view;
+  /** The filteredlist's model of visible rows. */
+  ListModel *model;
+  /** The filter of the filteredlist's items and rows. */
+  Filter filter;
+  /** The ID of the source streaming items into the list, or 0. */
+  int source;
+  /** The channel items are streamed from, or `NULL`. */
+  GIOChannel *channel;
+  /** The reader of streamed items. */
+  ItemReader *reader;
+  /** The generation of the current filter. Background filters of older generations stop. */
+  int generation;
+  /** The number of background filters whose final results have not been shown yet. */
+  int filters;
+  /** The thread pool background filters run in, one at a time. */
+  GThreadPool *filter_thread;
+  /** The link background filter results refer to the list by, or `NULL`. */
+  struct ListLink *link;
+  /** The number of microseconds the last completed filter took. */
+  gint64 filter_time;
+  /** The string selected items are output to. */
+  GString *output;
+  /** The filteredlist's dialog. */
+  const DialogContext *context;
+} FilteredList;
+
+/**
+ * A counted reference to a filteredlist that background filter results hold, so results still
+ * pending when the list is stopped can be discarded without the list.
+ */
+typedef struct ListLink {
+  /** The filteredlist, or `NULL` once it has stopped. */
+  FilteredList *list;
+  /** The number of references. It is accessed atomically. */
+  int refs;
+} ListLink;
+
+/** Releases a reference to the given filteredlist link, freeing it if it was the last one. */
+static void unref_list_link(ListLink *link) {
+  if (g_atomic_int_dec_and_test(&link->refs)) free(link);
+}
+
+/**
+ * A filteredlist filter running in the background.
+ * It has its own copy of the query so the entry may change while it runs.
+ */
+typedef struct {
+  FilteredList *list;
+  /** The list generation the filter is for. */
+  int generation;
+  /** The lowercase query. */
+  char *query;
+  /** The prepared query. */
+  Matcher matcher;
+  /** The number of rows to filter. */
+  int num_rows;
+  /** The time partial results were last shown. */
+  gint64 reported;
+  /** The number of rows last shown. */
+  int reported_len;
+} ListFilter;
+
+/** Background filter results to show in a filteredlist. */
+typedef struct {
+  /** The link to the filteredlist the results are for. */
+  ListLink *link;
+  /** The list generation the results are for. */
+  int generation;
+  /** The list of matching rows, or `NULL` if filtering was cancelled. */
+  int *rows;
+  /** The number of rows in *rows*. */
+  int len;
+  /** Whether or not *rows* is in ranked order rather than ascending order. */
+  int ranked;
+  /** Whether or not the results are final rather than partial. */
+  int done;
+  /** The number of microseconds filtering took. */
+  gint64 time;
+} ListRows;
+
+/**
+ * Function for iterating over filteredlist selections.
+ * Concatenates all selections into a single string delimited by newline
+ * characters.
+ */
+static void list_foreach(
+  GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, gpointer userdata) {
+  FilteredList *list = (FilteredList *)userdata;
+  int row = list_model_iter_row(model, iter);
+  if (!list->context->string_output)
+    g_string_append_printf(list->output, "%i\n", row);
+  else {
+    size_t len = 0;
+    const char *item = filter_item(&list->filter, row, list->context->output_col - 1, &len);
+    if (item) g_string_append_len(list->output, item, len);
+    g_string_append_c(list->output, '\n');
+  }
+}
+
+/** Signal for the 'enter' key being pressed in the filteredlist view. */
+static gboolean list_keypress(GtkWidget *treeview, GdkEventKey *event, gpointer userdata) {
+  if (event->keyval == 0xff0d) // return key
+    return (g_signal_emit_by_name(userdata, "response", 1), TRUE);
+  return FALSE;
+}
+
+/** Signal for a row being activated in the filteredlist view. */
+static gboolean list_select(
+  GtkTreeView *treeview, GtkTreePath *path, GtkTreeViewColumn *column, gpointer userdata) {
+  return (g_signal_emit_by_name(userdata, "response", 1), TRUE);
+}
+
+/** Returns whether or not the given filteredlist row matches the given prepared query. */
+static int list_row_matches(FilteredList *list, const Matcher *matcher, int row) {
+  Filter *filter = &list->filter;
+  if (row * filter->ncols + filter->search_col - 1 >= filter->items.len) return TRUE; // no data
+  return filter_match(matcher, &filter->keys, row);
+}
+
+/** Returns whether or not the given row matches the filter of the filteredlist in userdata. */
+static int list_visible(int row, void *userdata) {
+  FilteredList *list = (FilteredList *)userdata;
+  return list_row_matches(list, &list->filter.matcher, row);
+}
+
+/** Returns whether or not the given row matches the background ListFilter in userdata. */
+static int list_filter_visible(int row, void *userdata) {
+  ListFilter *filter = (ListFilter *)userdata;
+  return list_row_matches(filter->list, &filter->matcher, row);
+}
+
+/** qsort() comparison function for sorting integers in ascending order. */
+static int compare_ints(const void *a, const void *b) {
+  return (*(const int *)a > *(const int *)b) - (*(const int *)a < *(const int *)b);
+}
+
+/**
+ * Shows the given list of rows in the filteredlist, which takes ownership of them.
+ * When many rows change, or when rows are ranked, the model is detached from the view while its
+ * rows are replaced so the view does not have to process a signal per row. Any selected rows that
+ * are still visible are selected again afterwards.
+ * @param list The filteredlist.
+ * @param rows The list of visible rows, in ascending order unless ranked.
+ * @param len The number of rows in *rows*.
+ * @param size The allocated number of *rows*.
+ * @param ranked Whether or not *rows* is in ranked order rather than ascending order.
+ */
+static void set_list_rows(FilteredList *list, int *rows, int len, int size, int ranked) {
+  ListModel *model = list->model;
+  if (!ranked && list_model_changes(model, rows, len) <= 1000) {
+    list_model_set_rows(model, rows, len, size, FALSE);
+    return;
+  }
+  GtkTreeSelection *selection = gtk_tree_view_get_selection(list->view);
+  GList *paths = gtk_tree_selection_get_selected_rows(selection, NULL), *p;
+  int nselected = 0, *selected = malloc(sizeof(int) * (g_list_length(paths) + 1));
+  for (p = paths; p; p = p->next)
+    selected[nselected++] = model->rows[gtk_tree_path_get_indices(p->data)[0]];
+  g_list_free_full(paths, (GDestroyNotify)gtk_tree_path_free);
+  qsort(selected, nselected, sizeof(int), compare_ints);
+  gtk_tree_view_set_model(list->view, NULL);
+  list_model_set_rows(model, rows, len, size, TRUE);
+  gtk_tree_view_set_model(list->view, GTK_TREE_MODEL(model));
+  for (int i = 0; i < len && nselected > 0; i++)
+    if (bsearch(&rows[i], selected, nselected, sizeof(int), compare_ints)) {
+      GtkTreePath *path = gtk_tree_path_new_from_indices(i, -1);
+      gtk_tree_selection_select_path(selection, path);
+      gtk_tree_path_free(path);
+    }
+  free(selected);
+}
+
+/**
+ * Selects the first row in the given filteredlist.
+ * @param list The filteredlist.
+ * @param unselected Whether or not to only select it if no row is selected.
+ */
+static void select_list_row(FilteredList *list, int unselected) {
+  GtkTreeSelection *selection = gtk_tree_view_get_selection(list->view);
+  GtkTreeIter iter;
+  if ((!unselected || gtk_tree_selection_count_selected_rows(selection) == 0) &&
+    gtk_tree_model_get_iter_first(GTK_TREE_MODEL(list->model), &iter))
+    gtk_tree_selection_select_iter(selection, &iter);
+}
+
+/**
+ * Updates the given filteredlist's filter from its entry text.
+ * @return `TRUE` if the filter changed, `FALSE` otherwise
+ */
+static int set_list_filter(FilteredList *list) {
+  return filter_set_query(&list->filter, gtk_entry_get_text(list->entry));
+}
+
+static void watch_list_items(FilteredList *list);
+
+/**
+ * Shows background filter results in their filteredlist, unless a newer filter replaced them or
+ * the list has stopped.
+ * Once no background filters remain, streaming items resumes.
+ * @param userdata ListRows, which is freed.
+ */
+static gboolean show_list_rows(gpointer userdata) {
+  ListRows *update = (ListRows *)userdata;
+  FilteredList *list = update->link->list;
+  if (list && update->done) {
+    list->filters--;
+    if (update->rows) list->filter_time = update->time;
+  }
+  if (list && update->rows && update->generation == list->generation) {
+    set_list_rows(list, update->rows, update->len, update->len + 1, update->ranked);
+    select_list_row(list, !update->done);
+  } else
+    free(update->rows);
+  if (list && list->filters == 0 && list->channel && !list->source) watch_list_items(list);
+  unref_list_link(update->link), free(update);
+  return FALSE;
+}
+
+/**
+ * Sends the given background filter results to the main loop to be shown.
+ * @param filter The background filter.
+ * @param rows The list of matching rows, which is copied, or `NULL` if filtering was cancelled.
+ * @param len The number of rows in *rows*.
+ * @param ranked Whether or not *rows* is in ranked order.
+ * @param done Whether or not the results are final.
+ * @param time The number of microseconds filtering took.
+ */
+static void send_list_rows(
+  ListFilter *filter, const int *rows, int len, int ranked, int done, gint64 time) {
+  ListRows *update = malloc(sizeof(ListRows));
+  update->link = filter->list->link, update->generation = filter->generation;
+  g_atomic_int_inc(&update->link->refs);
+  update->rows = rows ? memcpy(malloc(sizeof(int) * (len + 1)), rows, sizeof(int) * len) : NULL;
+  update->len = len, update->ranked = ranked, update->done = done, update->time = time;
+  g_idle_add(show_list_rows, update);
+}
+
+/**
+ * Reports background filter progress, sending partial results to be shown periodically.
+ * Ranked results are only sent once they are final.
+ * @param userdata ListFilter.
+ * @return `FALSE` if the filter was replaced by a newer one, `TRUE` otherwise
+ */
+static int report_list_filter(const int *rows, int len, void *userdata) {
+  ListFilter *filter = (ListFilter *)userdata;
+  if (g_atomic_int_get(&filter->list->generation) != filter->generation) return FALSE;
+  gint64 now = g_get_monotonic_time();
+  if (!filter->matcher.fuzzy && len > filter->reported_len &&
+    now - filter->reported >= LIST_FILTER_REPORT_INTERVAL)
+    send_list_rows(filter, rows, len, FALSE, FALSE, 0), filter->reported = now,
+      filter->reported_len = len;
+  return TRUE;
+}
+
+/**
+ * Thread function for filtering a filteredlist in the background.
+ * Streaming items is paused while background filters run, so the list's items and keys do not
+ * change, and only one background filter uses the list's cache at a time.
+ * @param data ListFilter, which is freed.
+ */
+static void filter_list_thread(gpointer data, gpointer userdata) {
+  ListFilter *filter = (ListFilter *)data;
+  FilteredList *list = filter->list;
+  gint64 start = filter->reported = g_get_monotonic_time();
+  int len = 0, *rows = NULL;
+  if (g_atomic_int_get(&list->generation) == filter->generation)
+    rows = filter_rows(&list->filter, filter->query, &filter->matcher, filter->num_rows,
+      list_filter_visible, report_list_filter, filter, &len);
+  int ranked = rows && filter->matcher.fuzzy && filter->matcher.len > 0;
+  if (ranked) {
+    rows = memcpy(malloc(sizeof(int) * (len + 1)), rows, sizeof(int) * len);
+    filter_rank(&filter->matcher, &list->filter.keys, rows, len);
+  }
+  send_list_rows(filter, rows, len, ranked, TRUE, g_get_monotonic_time() - start);
+  if (ranked) free(rows);
+  free(filter->query), filter_free_matcher(&filter->matcher), free(filter);
+}
+
+/**
+ * Filters the given filteredlist against its entry text.
+ * Filters that are expected to be slow, based on how long the last one took, run in the
+ * background, and replace any background filter still running. Their results are shown as they
+ * arrive.
+ */
+static void filter_list(FilteredList *list) {
+  if (!set_list_filter(list)) return;
+  g_atomic_int_inc(&list->generation); // stop any background filter
+  if (list->filters > 0 || list->filter_time > LIST_FILTER_SYNC_MAX) {
+    ListFilter *filter = calloc(1, sizeof(ListFilter));
+    filter->list = list, filter->generation = list->generation;
+    filter->query = copy(list->filter.query), filter->matcher.fuzzy = list->filter.matcher.fuzzy;
+    filter_set_matcher(&filter->matcher, filter->query), filter->num_rows = list->filter.num_rows;
+    if (!list->filter_thread) {
+      list->filter_thread = g_thread_pool_new(filter_list_thread, NULL, 1, FALSE, NULL);
+      list->link = malloc(sizeof(ListLink)), list->link->list = list, list->link->refs = 1;
+    }
+    list->filters++, g_thread_pool_push(list->filter_thread, filter, NULL);
+    return;
+  }
+  gint64 start = g_get_monotonic_time();
+  Filter *filter = &list->filter;
+  int len, *matches = filter_rows(filter, filter->query, &filter->matcher, filter->num_rows,
+              list_visible, NULL, list, &len);
+  int *rows = memcpy(malloc(sizeof(int) * (len + 1)), matches, sizeof(int) * len);
+  int ranked = filter->matcher.fuzzy && filter->matcher.len > 0;
+  if (ranked) filter_rank(&filter->matcher, &filter->keys, rows, len);
+  list->filter_time = g_get_monotonic_time() - start;
+  set_list_rows(list, rows, len, len + 1, ranked);
+  select_list_row(list, FALSE);
+}
+
+/** Signal for a keypress in the filteredlist entry. */
+static gboolean entry_keypress(GtkWidget *entry, GdkEventKey *event, gpointer userdata) {
+  return (filter_list((FilteredList *)userdata), FALSE);
+}
+
+/**
+ * Function for rendering a filteredlist cell from the items in its row.
+ * The renderer's "column" data is the cell's column number.
+ */
+static void render_list_cell(GtkTreeViewColumn *column, GtkCellRenderer *renderer,
+  GtkTreeModel *model, GtkTreeIter *iter, gpointer userdata) {
+  FilteredList *list = (FilteredList *)userdata;
+  int col = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(renderer), "column"));
+  size_t len = 0;
+  const char *item = filter_item(&list->filter, list_model_iter_row(model, iter), col, &len);
+  char *text = item ? g_strndup(item, len) : NULL;
+  g_object_set(G_OBJECT(renderer), "text", text, NULL);
+  g_free(text);
+}
+
+/**
+ * Adds rows to the filteredlist for its items that are not yet part of a row, showing those that
+ * match its filter.
+ * @param list The filteredlist.
+ * @param partial Whether or not to create a row for a trailing, incomplete set of items.
+ */
+static void add_list_rows(FilteredList *list, int partial) {
+  for (int row = filter_add_rows(&list->filter, partial); row < list->filter.num_rows; row++)
+    if (list_visible(row, list)) list_model_append(list->model, row);
+}
+
+/**
+ * Appends the given streamed item to the filteredlist given as userdata, and adds a row for it
+ * once its row is complete.
+ */
+static void add_list_item(char *item, void *userdata) {
+  FilteredList *list = (FilteredList *)userdata;
+  filter_add_item(&list->filter, item, strlen(item));
+  if (list->filter.items.len % list->filter.ncols == 0) add_list_rows(list, FALSE);
+}
+
+/**
+ * Signal for when filteredlist items are available to be read.
+ * Only one batch of items is read at a time so the dialog stays responsive while large lists
+ * are loading. Reading pauses while background filters run.
+ * @param userdata ItemReader whose userdata is a FilteredList.
+ */
+static gboolean read_list_items(GIOChannel *channel, GIOCondition condition, gpointer userdata) {
+  ItemReader *reader = (ItemReader *)userdata;
+  FilteredList *list = (FilteredList *)reader->userdata;
+  if (list->filters > 0) return (list->source = 0, FALSE); // resumed by show_list_rows()
+  gsize n = 0;
+  GIOStatus status = G_IO_STATUS_EOF;
+  if (condition & G_IO_IN)
+    status = g_io_channel_read_chars(channel, filter_reader_space(reader), ITEMS_BATCH, &n, NULL);
+  int eof = status != G_IO_STATUS_NORMAL && status != G_IO_STATUS_AGAIN;
+  filter_read(reader, n, eof);
+  if (eof) {
+    add_list_rows(list, TRUE), list->source = 0;
+    g_io_channel_unref(list->channel), list->channel = NULL;
+    filter_index(&list->filter);
+  }
+  select_list_row(list, TRUE);
+  return !eof;
+}
+
+/** Watches the given filteredlist's channel for items to read while the dialog is idle. */
+static void watch_list_items(FilteredList *list) {
+  list->source = g_io_add_watch_full(list->channel, G_PRIORITY_DEFAULT_IDLE, G_IO_IN | G_IO_HUP,
+    read_list_items, list->reader, NULL);
+}
+
+/**
+ * Streams filteredlist items from the given channel in batches while the dialog is idle.
+ * @param channel The channel to read items from. It is released when streaming finishes.
+ * @param reader ItemReader whose userdata is a FilteredList.
+ */
+static void stream_list_items(GIOChannel *channel, ItemReader *reader) {
+  FilteredList *list = (FilteredList *)reader->userdata;
+  g_io_channel_set_encoding(channel, NULL, NULL), g_io_channel_set_buffered(channel, FALSE);
+  list->channel = channel, list->reader = reader;
+  watch_list_items(list);
+}
+
+/**
+ * Stops streaming items into the given filteredlist and cancels its background filters.
+ * Cancelled filters finish before returning. Their results still pending in the main loop no
+ * longer refer to the list, and are discarded when they arrive.
+ */
+static void stop_list(FilteredList *list) {
+  if (list->source) g_source_remove(list->source), list->source = 0;
+  if (list->channel) g_io_channel_unref(list->channel), list->channel = NULL;
+  g_atomic_int_inc(&list->generation);
+  if (list->filter_thread) g_thread_pool_free(list->filter_thread, FALSE, TRUE);
+  list->filter_thread = NULL;
+  if (list->link) list->link->list = NULL, unref_list_link(list->link), list->link = NULL;
+}
+
+/**
+ * Signal for a dialog timeout.
+ * @param userdata The dialog's DialogContext.
+ */
+static gboolean timeout_dialog(gpointer userdata) {
+  DialogContext *context = (DialogContext *)userdata;
+  context->timeout_source = 0;
+  return (g_signal_emit_by_name(context->dialog, "response", RESPONSE_TIMEOUT), FALSE);
+}
+
+/**
+ * Closes the given running dialog as if the user had closed its window.
+ * @param context The dialog's DialogContext.
+ */
+static void close_dialog(DialogContext *context) {
+#if GTK_CHECK_VERSION(3, 20, 0)
+  if (GTK_IS_NATIVE_DIALOG(context->dialog)) {
+    // A hidden native dialog does not respond on its own.
+    gtk_native_dialog_hide(GTK_NATIVE_DIALOG(context->dialog));
+    g_signal_emit_by_name(context->dialog, "response", GTK_RESPONSE_DELETE_EVENT);
+    return;
+  }
+#endif
+  gtk_dialog_response(GTK_DIALOG(context->dialog), GTK_RESPONSE_DELETE_EVENT);
+}
+
+/** Signal for a textbox being scrolled, so it follows the end of its text only while there. */
+static void text_stream_scrolled(GtkAdjustment *adjustment, gpointer userdata) {
+  TextStream *stream = (TextStream *)userdata;
+  double bottom = gtk_adjustment_get_value(adjustment) + gtk_adjustment_get_page_size(adjustment);
+  stream->following = bottom >= gtk_adjustment_get_upper(adjustment) - 1;
+}
+
+/**
+ * Appends the text read by the given textbox stream to its textbox.
+ * Invalid UTF-8 is replaced, and an incomplete character is kept until the rest of it is read.
+ * Lines beyond the stream's limit are dropped from the start of the textbox.
+ */
+static void show_text_stream(TextStream *stream) {
+  GtkTextBuffer *buffer = gtk_text_view_get_buffer(stream->view);
+  GtkTextIter start, end;
+  gtk_text_buffer_get_end_iter(buffer, &end);
+  const gchar *p = stream->buf, *last = p + stream->len, *valid;
+  for (;; p = valid + 1) {
+    int ok = g_utf8_validate(p, last - p, &valid);
+    gtk_text_buffer_insert(buffer, &end, p, valid - p);
+    if (ok || (stream->fd >= 0 && g_utf8_get_char_validated(valid, last - valid) == (gunichar)-2))
+      break;
+    gtk_text_buffer_insert(buffer, &end, "\xEF\xBF\xBD", 3); // U+FFFD replacement character
+  }
+  memmove(stream->buf, valid, stream->len = last - valid);
+  int lines = gtk_text_buffer_get_line_count(buffer) - (gtk_text_iter_starts_line(&end) ? 1 : 0);
+  if (stream->max_lines && lines > stream->max_lines) {
+    gtk_text_buffer_get_start_iter(buffer, &start);
+    gtk_text_buffer_get_iter_at_line(buffer, &end, lines - stream->max_lines);
+    gtk_text_buffer_delete(buffer, &start, &end), gtk_text_buffer_get_end_iter(buffer, &end);
+  }
+  GtkTextMark *mark = gtk_text_buffer_get_mark(buffer, "stream-end"); // stays at the end
+  if (!mark) mark = gtk_text_buffer_create_mark(buffer, "stream-end", &end, FALSE);
+  if (stream->following) gtk_text_view_scroll_to_mark(stream->view, mark, 0, FALSE, 0, 0);
+  stream->redraw_time = g_get_monotonic_time();
+}
+
+/**
+ * Timeout function for showing the text read by a textbox stream.
+ * @param userdata The textbox's TextStream.
+ */
+static gboolean redraw_text_stream(gpointer userdata) {
+  TextStream *stream = (TextStream *)userdata;
+  stream->redraw_source = 0;
+  return (show_text_stream(stream), FALSE);
+}
+
+/**
+ * Shows the text read by the given textbox stream once at least one redraw interval has passed
+ * since text was last shown.
+ */
+static void queue_text_stream_redraw(TextStream *stream) {
+  if (!stream->len || stream->redraw_source) return;
+  int64_t wait = stream->redraw_time + REDRAW_INTERVAL - g_get_monotonic_time();
+  stream->redraw_source = g_timeout_add(wait > 0 ? wait / 1000 : 0, redraw_text_stream, stream);
+}
+
+/**
+ * Signal for when stdin or a followed file's inotify descriptor has input for a textbox stream.
+ * @param userdata The textbox's TextStream.
+ */
+static gboolean read_text(GIOChannel *channel, GIOCondition condition, gpointer userdata) {
+  TextStream *stream = (TextStream *)userdata;
+  int eof = !(condition & G_IO_IN) || !read_text_stream(stream);
+  if (eof && !stream->follow) stream->fd = -1; // any incomplete character is shown as invalid
+  if (eof) stream->read_source = 0;
+  return (queue_text_stream_redraw(stream), !eof);
+}
+
+/**
+ * Timeout function for checking a followed file that cannot be watched for new text.
+ * @param userdata The textbox's TextStream.
+ */
+static gboolean poll_text_file(gpointer userdata) {
+  TextStream *stream = (TextStream *)userdata;
+  return (read_text_stream(stream), queue_text_stream_redraw(stream), TRUE);
+}
+
+/**
+ * Shows the text already read by the given textbox stream and keeps reading it while the dialog
+ * runs.
+ * @param stream The stream to read. Its textbox must be in a scrolled window.
+ */
+static void watch_text_stream(TextStream *stream) {
+  GtkAdjustment *adjustment = gtk_scrolled_window_get_vadjustment(
+    GTK_SCROLLED_WINDOW(gtk_widget_get_parent(GTK_WIDGET(stream->view))));
+  g_signal_connect(adjustment, "value-changed", G_CALLBACK(text_stream_scrolled), stream);
+  show_text_stream(stream);
+  if (stream->follow && stream->notify_fd < 0) {
+    stream->read_source = g_timeout_add(FOLLOW_INTERVAL, poll_text_file, stream);
+    return;
+  }
+  GIOChannel *ch = g_io_channel_unix_new(stream->follow ? stream->notify_fd : stream->fd);
+  g_io_channel_set_encoding(ch, NULL, NULL), g_io_channel_set_buffered(ch, FALSE);
+  stream->read_source = g_io_add_watch(ch, G_IO_IN | G_IO_HUP, read_text, stream);
+  g_io_channel_unref(ch); // the watch holds a reference
+}
+#elif CURSES
+/**
+ * Lays out the given row of the given curses multi-task progressbar's task label, if the row is
+ * visible.
+ */
+static void layout_task_row(DialogContext *context, int row) {
+  if (row >= context->num_task_lines) return;
+  char *line = context->task_lines[row];
+  size_t width = context->task_width;
+  memset(line, ' ', width);
+  if (row >= context->tasks->num_rows) return; // blank
+  Task *task = context->tasks->rows[row];
+  int percent = task->progress.percent;
+  const char *text = task->progress.text ? task->progress.text : "";
+  snprintf(line, width + 1, "[%-10.*s] %3d%% %s: %s", percent / 10, "##########", percent,
+    task->id, text);
+  line[strlen(line)] = ' ', line[width] = '\0'; // keep padding
+}
+
+/**
+ * Shows the given curses multi-task progressbar's changed tasks, adding rows for tasks that
+ * started and removing rows of tasks that finished.
+ * Only changed rows are laid out again.
+ */
+static void show_tasks(DialogContext *context) {
+  Tasks *tasks = context->tasks;
+  if (tasks->queue_len == 0) return;
+  for (int i = 0; i < tasks->queue_len; i++) {
+    Task *task = tasks->queue[i];
+    task->queued = FALSE;
+    if (task->progress.percent == 100) {
+      if (task->row < 0) continue;
+      int row = task->row;
+      remove_task_row(tasks, task);
+      layout_task_row(context, row), layout_task_row(context, tasks->num_rows);
+      continue;
+    }
+    if (task->row < 0) add_task_row(tasks, task);
+    layout_task_row(context, task->row);
+  }
+  tasks->queue_len = 0;
+  if (!context->task_label) return;
+  setCDKLabelMessage(context->task_label, context->task_lines, context->num_task_lines);
+  drawCDKLabel(context->task_label, FALSE);
+}
+
+/** Shows the given progressbar's pending input, if any. */
+static void show_progressbar_input(DialogContext *context) {
+  ProgressInput *progress = &context->progress;
+  if (!progress->pending) return;
+  if (context->tasks) show_tasks(context);
+  // Only redraw what changed.
+  if (!context->indeterminate && progress->percent != getCDKSliderValue(context->progressbar))
+    setCDKSliderValue(context->progressbar, progress->percent),
+      drawCDKSlider(context->progressbar, FALSE);
+  if (progress->text_changed) {
+    char *line = context->progress_line;
+    size_t width = strlen(line), len = strlen(progress->text);
+    memset(line, ' ', width), memcpy(line, progress->text, len < width ? len : width);
+    setCDKLabelMessage(context->progress_label, &line, 1);
+    drawCDKLabel(context->progress_label, FALSE);
+  }
+  if (progress->stop >= 0 && progress->stop != context->stop_enabled) {
+    context->stop_enabled = progress->stop;
+    setCDKButtonboxHighlight(context->buttonbox, progress->stop ? A_REVERSE : A_NORMAL);
+    drawCDKButtonbox(context->buttonbox, TRUE);
+  }
+  progress->pending = progress->text_changed = FALSE, progress->stop = -1;
+  context->redraw_time = monotonic_time();
+}
+
+/** Returns whether or not the given key press stops the given curses progressbar. */
+static int stops_progressbar(DialogContext *context, int key) {
+  return (key == KEY_ENTER || key == '\n') && context->stop_enabled;
+}
+
+#if !_WIN32
+/**
+ * Updates the given curses progressbar from stdin until input ends or the progressbar is
+ * stopped.
+ * Stdin and the terminal are polled together so the dialog sleeps until there is input or a key
+ * press. Input is read in batches, and only the latest input is shown, at most once per redraw
+ * interval.
+ * @return TRUE if the progressbar was stopped, FALSE otherwise.
+ */
+static int run_progressbar_input(DialogContext *context) {
+  int tty = open("/dev/tty", O_RDONLY), stopped = FALSE, eof = FALSE;
+  struct pollfd fds[2] = {{context->stdin_fd, POLLIN, 0}, {tty, POLLIN, 0}};
+  while (!eof && !stopped) {
+    int wait = -1; // until there is input or a key press
+    if (context->progress.pending) {
+      int64_t due = context->redraw_time + REDRAW_INTERVAL - monotonic_time();
+      wait = due > 0 ? (due + 999) / 1000 : 0;
+    }
+    fds[0].revents = fds[1].revents = 0;
+    poll(fds, tty >= 0 ? 2 : 1, wait);
+    if (fds[0].revents) eof = !read_progressbar_input(context);
+    if (fds[1].revents) {
+      // Handle every key curses has read, not just those still waiting on the terminal.
+      timeout(0);
+      for (int key; !stopped && (key = getch()) != ERR;) stopped = stops_progressbar(context, key);
+      timeout(-1);
+    }
+    if (context->redraw_time + REDRAW_INTERVAL <= monotonic_time())
+      show_progressbar_input(context);
+  }
+  if (tty >= 0) close(tty);
+  return stopped;
+}
+#endif
+
+/**
+ * Returns the number of lines the given string occupies when wrapped to fit the
+ * given number of characters per line and sets the given pointer to the wrapped
+ * set of lines.
+ * @param arena The arena to allocate the set of lines from.
+ * @param str The string to wrap. It is modified in place.
+ * @param w The number of characters per line to wrap at.
+ * @param plines An empty pointer that will ultimately contain the set of
+ *   wrapped lines.
+ * @return int number of wrapped lines
+ */
+static int wrap(Arena *arena, char *str, int w, char ***plines) {
+  // Wrap lines by replacing spaces with '\n' at the appropriate locations.
+  int len = strlen(str);
+  for (int i = w; i < len; i += w) {
+    int j = i;
+    while (j >= 0 && !isspace(str[j])) j--;
+    if (j + w > i) i = j, str[i++] = '\n'; // line length < w; cut here
+  }
+  // Count the number of '\n's to get the number of wrapped lines.
+  int nlines = 1;
+  char *p = str - 1;
+  while ((p = strstr(p + 1, "\n"))) nlines++;
+  // Create the list of lines.
+  char **lines = arena_alloc(arena, nlines * sizeof(char *));
+  lines[0] = str;
+  for (int i = 1; i < nlines; i++) {
+    p = strstr(lines[i - 1], "\n"), *p = '\0';
+    lines[i] = p + 1;
+  }
+  *plines = lines;
+  return nlines;
+}
+
+/**
+ * Signal for the 'tab' and 'shift+tab' keys being pressed.
+ * @param data The inputbox's DialogContext.
+ */
+static int entries_tab(EObjectType cdkType, void *object, void *data, chtype key) {
+  DialogContext *context = (DialogContext *)data;
+  CDKENTRY *entry = (CDKENTRY *)object, **entries = context->entries;
+  int i = 0, len = 0;
+  for (len = 0; entries[len]; len++)
+    if (entries[len] == entry) i = len;
+  if (key == KEY_TAB || key == KEY_DOWN)
+    context->focused_entry = entries[i + 1];
+  else
+    context->focused_entry = (i > 0) ? entries[i - 1] : entries[len - 1];
+  return (injectCDKEntry(entry, KEY_ENTER), TRUE);
+}
+
+/** Signal for the 'tab' and 'shift+tab' keys being pressed. */
+static int buttonbox_tab(EObjectType cdkType, void *object, void *data, chtype key) {
+  return (injectCDKButtonbox((CDKBUTTONBOX *)data, key), TRUE);
+}
+
+/** The curses filteredlist model. */
+typedef struct {
+  /** The number of columns. */
+  int ncols;
+  /** The list of column names. */
+  char **cols;
+  /** The filter of the raw list of items and its rows. */
+  Filter filter;
+  /** The display widths of columns. */
+  int *col_widths;
+  /** The display width of each item, or -1 if it has not been measured yet. */
+  int *widths;
+  /** The allocated number of *widths*. */
+  int widths_size;
+  /** The column header display row. */
+  char *header;
+  /**
+   * The index of the first filtered row in the scroll list.
+   * Only the filtered rows that fit in the scroll list are formatted for display and given to it.
+   */
+  int top;
+  /** The index of the selected filtered row. */
+  int current;
+  /** The number of display columns rows are scrolled to the right by. */
+  int left;
+  /** The indices of filtered rows. They are owned by *filter*. */
+  int *filtered;
+  /** The number of filtered rows. */
+  int num_filtered;
+  /** The CDKENTRY the model is assigned to. */
+  CDKENTRY *entry;
+  /** CDKSCROLL the model is assigned to. */
+  CDKSCROLL *scrolled;
+  /** The file descriptor items are streamed from, or -1. */
+  int fd;
+  /** Whether or not to close *fd* when streaming finishes. */
+  int close_fd;
+  /** The reader of streamed items. */
+  ItemReader reader;
+} Model;
+
+/** Returns the number of rows that fit in the given curses filteredlist model's scroll list. */
+static int model_page_size(Model *model) {
+  CDKSCROLL *scrolled = model->scrolled;
+  int page = scrolled->boxHeight - 2 * BorderOf(scrolled) - TitleLinesOf(scrolled);
+  return (page > 0) ? page : 1;
+}
+
+static void show_model_rows(Model *model);
+
+/**
+ * Filters the given curses filteredlist model's rows against its entry text, selects the first
+ * matching row, and updates its scroll list.
+ * @param model The model to filter.
+ */
+static void filter_model(Model *model) {
+  filter_set_query(&model->filter, getCDKEntryValue(model->entry));
+  model->filtered = filter_matches(&model->filter, &model->num_filtered);
+  model->top = model->current = 0, show_model_rows(model);
+}
+
+/**
+ * Redraws the given curses filteredlist model's scroll list and entry.
+ * Since the scroll list only has the filtered rows that fit in it, its scrollbar is drawn over
+ * to show the position of the selected row among all filtered rows.
+ */
+static void draw_model(Model *model) {
+  CDKSCROLL *scrolled = model->scrolled;
+  HasFocusObj(ObjOf(scrolled)) = TRUE; // needed to draw highlight
+  eraseCDKScroll(scrolled); // drawCDKScroll does not completely redraw
+  drawCDKScroll(scrolled, TRUE), drawCDKEntry(model->entry, FALSE);
+  HasFocusObj(ObjOf(scrolled)) = FALSE;
+  WINDOW *bar = scrolled->scrollbarWin;
+  if (!bar || model->num_filtered == 0) return;
+  int height = getmaxy(bar), n = model->num_filtered;
+  int size = (long long)height * model_page_size(model) / n;
+  if (size < 1) size = 1;
+  if (size > height) size = height;
+  int pos = (n > 1) ? (long long)(height - size) * model->current / (n - 1) : 0;
+  mvwvline(bar, 0, 0, ACS_CKBOARD, height), mvwvline(bar, pos, 0, ' ' | A_REVERSE, size);
+  wrefresh(bar);
+}
+
+/** Signal for a keypress in the filteredlist entry. */
+static int entry_keypress(EObjectType cdkType, void *object, void *data, chtype key) {
+  Model *model = (Model *)data;
+  filter_model(model), draw_model(model);
+  return TRUE;
+}
+
+// Does not exist on _WIN32, but exists on other platforms with or without
+// feature test macros. Just define as a macro anyway.
+#define stpcpy_(d, s) (strcpy(d, s), d + strlen(s))
+
+#if !HAVE_CDKUTF8
+/** Returns the number of bytes in the given UTF-8 character. */
+static unsigned int utf8charlen(unsigned char ch) {
+  if (ch < 0x80)
+    return 1;
   else if (ch < 0x80 + 0x40 + 0x20)
     return 2;
   else if (ch < 0x80 + 0x40 + 0x20 + 0x10)
@@ -427,68 +2140,425 @@ static unsigned int utf8charlen(unsigned char ch) {
   else
     return 4;
 }
+#endif
+
+/**
+ * Decodes the UTF-8 character at the start of the given string.
+ * @param s The string to decode from.
+ * @param len The number of bytes left in *s*.
+ * @param ch Pointer to the decoded code point, which is set.
+ * @return number of bytes decoded
+ */
+static int utf8decode(const char *s, size_t len, unsigned int *ch) {
+  unsigned char c = *s;
+  int n = utf8charlen(c);
+  if ((size_t)n > len) n = len;
+  *ch = (n == 1) ? c : c & (0x7f >> n);
+  for (int i = 1; i < n; i++) *ch = (*ch << 6) | (s[i] & 0x3f);
+  return n;
+}
+
+/**
+ * Returns the number of terminal columns the given code point occupies.
+ * Combining marks and zero-width characters take none, and East Asian wide and fullwidth
+ * characters take two.
+ */
+static int char_width(unsigned int ch) {
+  if (ch < 0x300) return 1;
+  if (ch <= 0x36f || (ch >= 0x200b && ch <= 0x200f) || (ch >= 0xfe00 && ch <= 0xfe0f)) return 0;
+  if ((ch >= 0x1100 && ch <= 0x115f) || (ch >= 0x2e80 && ch <= 0xa4cf && ch != 0x303f) ||
+    (ch >= 0xac00 && ch <= 0xd7a3) || (ch >= 0xf900 && ch <= 0xfaff) ||
+    (ch >= 0xfe30 && ch <= 0xfe4f) || (ch >= 0xff00 && ch <= 0xff60) ||
+    (ch >= 0xffe0 && ch <= 0xffe6) || (ch >= 0x1f300 && ch <= 0x1f64f) ||
+    (ch >= 0x1f900 && ch <= 0x1f9ff) || (ch >= 0x20000 && ch <= 0x3fffd))
+    return 2;
+  return 1;
+}
+
+/** Returns the number of terminal columns the first *len* bytes of the given string occupy. */
+static int utf8width(const char *s, size_t len) {
+  int width = 0;
+  unsigned int ch;
+  for (size_t i = 0; i < len;)
+    if (!(s[i] & 0x80))
+      width++, i++;
+    else
+      i += utf8decode(s + i, len - i, &ch), width += char_width(ch);
+  return width;
+}
+
+/**
+ * Lays out a display row from the given list of row items, padding row items to fit the given
+ * column widths and separating them with the given character.
+ * The row may be scrolled horizontally, in which case it starts partway through.
+ * @param items The list of row items. They need not be '\0'-terminated.
+ * @param lens The lengths of row items.
+ * @param widths The display widths of row items.
+ * @param n The number of row items.
+ * @param col_widths The list of column widths.
+ * @param sep The column separator character.
+ * @param left The number of display columns to scroll the row to the right by.
+ * @param buf The buffer to write the '\0'-terminated row to, or `NULL` to only measure it.
+ * @return number of bytes the row needs, including its '\0'
+ */
+static size_t layout_row(const char **items, const size_t *lens, const int *widths, int n,
+  const int *col_widths, char sep, int left, char *buf) {
+  size_t size = 0;
+#define put(s, len) (buf ? (void)memcpy(buf + size, s, len) : (void)0, size += len)
+#define put_spaces(k) (buf ? (void)memset(buf + size, ' ', k) : (void)0, size += k)
+  for (int i = 0; i < n; i++) {
+    int padding = (col_widths[i] > widths[i]) ? col_widths[i] - widths[i] : 0;
+    int cell = widths[i] + padding + (i < n - 1);
+    if (left >= cell) {
+      left -= cell; // scrolled out of view
+      continue;
+    }
+    const char *s = items[i];
+    size_t len = lens[i];
+    unsigned int ch;
+    while (left > 0 && len > 0) {
+      int k = utf8decode(s, len, &ch);
+      s += k, len -= k, left -= char_width(ch);
+    }
+    if (left < 0) put_spaces(-left), left = 0; // wide character cut in half
+    put(s, len);
+    if (left > 0) padding -= left, left = 0;
+    put_spaces(padding);
+    if (i < n - 1) put(&sep, 1);
+  }
+  if (buf) buf[size] = '\0';
+#undef put
+#undef put_spaces
+  return size + 1;
+}
+
+/** The maximum number of rows measured to compute curses filteredlist column widths from. */
+#define LAYOUT_SAMPLE_SIZE 10000
+
+/**
+ * Returns the display width of the given item in the given curses filteredlist model, measuring
+ * it only the first time.
+ */
+static int item_width(Model *model, int i) {
+  if (i >= model->widths_size) {
+    int size = model->widths_size;
+    int len = model->filter.items.len;
+    model->widths_size = (2 * size > len) ? 2 * size : len;
+    model->widths = realloc(model->widths, sizeof(int) * model->widths_size);
+    for (int j = size; j < model->widths_size; j++) model->widths[j] = -1;
+  }
+  if (model->widths[i] < 0)
+    model->widths[i] =
+      utf8width(item_text(&model->filter.items, i), item_len(&model->filter.items, i));
+  return model->widths[i];
+}
+
+/**
+ * Lays out the given row of the given curses filteredlist model, scrolled horizontally by the
+ * model's scroll offset.
+ * @param model The model.
+ * @param row The row to lay out.
+ * @param buf The buffer to write the '\0'-terminated display row to, or `NULL` to only measure it.
+ * @return number of bytes the display row needs, including its '\0'
+ */
+static size_t model_row(Model *model, int row, char *buf) {
+  Items *items = &model->filter.items;
+  int ncols = model->ncols, i = row * ncols, n = (items->len - i < ncols) ? items->len - i : ncols;
+  const char *texts[ncols];
+  size_t lens[ncols];
+  int widths[ncols];
+  for (int j = 0; j < n; j++)
+    texts[j] = item_text(items, i + j), lens[j] = item_len(items, i + j),
+    widths[j] = item_width(model, i + j);
+  return layout_row(texts, lens, widths, n, model->col_widths, ' ', model->left, buf);
+}
+
+/**
+ * Lays out the given curses filteredlist model's column header, scrolled horizontally by the
+ * model's scroll offset. The header is underlined.
+ */
+static void layout_model_header(Model *model) {
+  int ncols = model->ncols, widths[ncols];
+  size_t lens[ncols];
+  for (int i = 0; i < ncols; i++)
+    lens[i] = strlen(model->cols[i]), widths[i] = utf8width(model->cols[i], lens[i]);
+  const char **cols = (const char **)model->cols;
+  size_t size = layout_row(cols, lens, widths, ncols, model->col_widths, '|', model->left, NULL);
+  free(model->header), model->header = malloc(strlen("</U>") + size);
+  layout_row(cols, lens, widths, ncols, model->col_widths, '|', model->left,
+    stpcpy_(model->header, "</U>"));
+}
+
+/**
+ * Computes the display widths of the given curses filteredlist model's columns from its items and
+ * column names, and lays out its column header.
+ * Each item is measured once. For large lists, only a sample of evenly spaced rows is measured.
+ * @param model The model to lay out.
+ * @param num_rows The number of rows to measure.
+ */
+static void layout_model(Model *model, int num_rows) {
+  int ncols = model->ncols, len = model->filter.items.len;
+  int step = (num_rows > LAYOUT_SAMPLE_SIZE) ? num_rows / LAYOUT_SAMPLE_SIZE : 1;
+  model->col_widths = malloc(sizeof(int) * ncols);
+  for (int i = 0; i < ncols; i++)
+    model->col_widths[i] = utf8width(model->cols[i], strlen(model->cols[i]));
+  for (int row = 0; row < num_rows; row += step)
+    for (int i = 0, j = row * ncols; i < ncols && j < len; i++, j++) {
+      int width = item_width(model, j);
+      if (width > model->col_widths[i]) model->col_widths[i] = width;
+    }
+  layout_model_header(model);
+}
+
+/**
+ * Adds rows to the given curses filteredlist model for its items that are not yet part of a row.
+ * Column widths are computed from the items present the first time rows are added.
+ * @param model The model to add rows to.
+ * @param partial Whether or not to create a row for a trailing, incomplete set of items.
+ */
+static void add_model_rows(Model *model, int partial) {
+  int ncols = model->ncols, len = model->filter.items.len;
+  if (!model->col_widths) layout_model(model, (len + ncols - 1) / ncols);
+  filter_add_rows(&model->filter, partial);
+}
+
+/**
+ * Scrolls the given curses filteredlist model's selected row into view and gives its scroll list
+ * the filtered rows that fit in it, laying out only those rows.
+ * The rows are laid out into a single buffer that is freed once the scroll list has copied them.
+ */
+static void show_model_rows(Model *model) {
+  int page = model_page_size(model);
+  if (model->current > model->num_filtered - 1) model->current = model->num_filtered - 1;
+  if (model->current < 0) model->current = 0;
+  if (model->top > model->current) model->top = model->current;
+  if (model->top < model->current - page + 1) model->top = model->current - page + 1;
+  int n = (model->num_filtered - model->top < page) ? model->num_filtered - model->top : page;
+  char *rows[page], *buf, *p;
+  size_t size = 0;
+  for (int i = 0; i < n; i++) size += model_row(model, model->filtered[model->top + i], NULL);
+  p = buf = malloc(size + 1);
+  for (int i = 0; i < n; i++)
+    rows[i] = p, p += model_row(model, model->filtered[model->top + i], p);
+  setCDKScrollItems(model->scrolled, rows, n, FALSE); // copies rows
+  if (n > 0) setCDKScrollCurrentItem(model->scrolled, model->current - model->top);
+  free(buf);
+}
+
+/** Adds a copy of the given streamed item to the curses filteredlist model given as userdata. */
+static void add_model_item(char *item, void *userdata) {
+  filter_add_item(&((Model *)userdata)->filter, item, strlen(item));
+}
+
+/**
+ * Reads the next batch of items for the given curses filteredlist model from its stream.
+ * @param model The model to read items for.
+ * @param wait The number of milliseconds to wait for input to become available.
+ * @return FALSE if the end of input has been reached, TRUE otherwise.
+ */
+static int read_model_items(Model *model, int wait) {
+#if !_WIN32
+  struct pollfd pfd = {model->fd, POLLIN, 0};
+  if (poll(&pfd, 1, wait) <= 0) return TRUE; // no input available yet, or interrupted
+#endif
+  int n = read(model->fd, filter_reader_space(&model->reader), ITEMS_BATCH);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return TRUE;
+  int eof = n <= 0;
+  filter_read(&model->reader, !eof ? n : 0, eof);
+  if (eof && model->close_fd) close(model->fd);
+  if (eof) model->fd = -1;
+  return !eof;
+}
+
+/**
+ * Signal for a keypress in the filteredlist entry while items are still being streamed in.
+ * Input times out while loading so that the next batch of items can be read and shown when there
+ * are no keypresses to handle.
+ */
+static int entry_load(EObjectType cdkType, void *object, void *data, chtype key) {
+  if (key != (chtype)ERR) return TRUE;
+  Model *model = (Model *)data;
+  int num_rows = model->filter.num_rows, eof = !read_model_items(model, 10);
+  add_model_rows(model, eof);
+  if (model->filter.num_rows > num_rows) {
+    int top = model->top, current = model->current;
+    filter_model(model);
+    model->top = top, model->current = current, show_model_rows(model), draw_model(model);
+  }
+  if (eof) {
+    wtimeout(InputWindowOf(model->entry), -1); // stop timing out
+    setCDKEntryPreProcess(model->entry, NULL, NULL);
+    filter_index(&model->filter);
+  }
+  return FALSE;
+}
+
+/**
+ * Signal for a scrolling keypress in the filteredlist entry.
+ * @param data The curses filteredlist model.
+ */
+static int scrolled_key(EObjectType cdkType, void *object, void *data, chtype key) {
+  Model *model = (Model *)data;
+  int page = model_page_size(model);
+  if (key == KEY_UP)
+    model->current--;
+  else if (key == KEY_DOWN)
+    model->current++;
+  else if (key == KEY_PPAGE)
+    model->current -= page, model->top -= page;
+  else if (key == KEY_NPAGE)
+    model->current += page, model->top += page;
+  else if (key == KEY_SLEFT || key == KEY_SRIGHT) {
+    int width = model->ncols - 1, left = model->left + ((key == KEY_SLEFT) ? -1 : 1);
+    for (int i = 0; i < model->ncols; i++) width += model->col_widths[i];
+    if (left < 0 || left >= width) return TRUE;
+    model->left = left, layout_model_header(model);
+    setCdkTitle(ObjOf(model->scrolled), model->header, model->scrolled->boxWidth);
+  }
+  if (model->top > model->num_filtered - page) model->top = model->num_filtered - page;
+  if (model->top < 0) model->top = 0;
+  show_model_rows(model), draw_model(model);
+  return TRUE;
+}
 
-/** Returns the number of characters in the given UTF-8 string. */
-static size_t utf8strlen(const char *s) {
-  size_t len = strlen(s), utf8len = 0;
-  for (size_t i = 0; i < len; i += utf8charlen((unsigned char)(s[i]))) utf8len++;
-  return utf8len;
+/**
+ * Appends the text read by the given textbox stream to its textbox, dropping lines beyond the
+ * stream's limit from the start of the textbox, and shows the end of the text.
+ */
+static void show_text_stream(TextStream *stream) {
+  if (!stream->len) return;
+  size_t len = stream->text_len + stream->len, width = stream->view->totalWidth;
+  if (len + 1 > stream->text_size)
+    stream->text = realloc(stream->text, stream->text_size = 2 * len + 1);
+  memcpy(stream->text + stream->text_len, stream->buf, stream->len), stream->text[len] = '\0';
+  size_t start = last_lines(stream->text, len, stream->max_lines);
+  memmove(stream->text, stream->text + start, (stream->text_len = len - start) + 1);
+  stream->len = 0;
+  // The textbox only holds so many characters, so give it the last ones.
+  len = stream->text_len;
+  setCDKMentryValue(stream->view, stream->text + (len > width ? len - width : 0));
+  injectCDKMentry(stream->view, KEY_END);
 }
-#endif
+
+/** Reads the next batch of text for the textbox stream given as userdata. */
+static int read_text_batch(void *userdata) { return read_text_stream((TextStream *)userdata); }
 
 /**
- * Creates and returns the set of display rows from the given list of columns,
- * number of columns, list of items, and number of items.
- * The returned list and its contents must be freed when finished. Note that the
- * returned list actually starts at index -1 where a column display row is. That
- * must be taken into account when freeing.
- * @param cols The list of column names.
- * @param ncols The number of columns.
- * @param items The list of items.
- * @param len The number of items.
+ * Signal for a keypress in the textbox or its buttons while text is being streamed in.
+ * Input times out so that the text read can be shown when there are no keypresses to handle.
+ * @param data The textbox's TextStream.
  */
-static char **item_rows(char **cols, int ncols, char **items, int len) {
-  // Compute the column sizes needed to fit all row items in.
-  int *col_widths = malloc(sizeof(int) * ncols), row_len = 0;
-  for (int i = 0; i < ncols; i++) {
-    int utf8max = utf8strlen(cols[i]), max = strlen(cols[i]);
-    for (int j = i; j < len; j += ncols) {
-      int utf8len = utf8strlen(items[j]);
-      if (utf8len > utf8max) utf8max = utf8len, max = strlen(items[j]);
-    }
-    col_widths[i] = utf8max, row_len += max + 1;
+static int textbox_load(EObjectType cdkType, void *object, void *data, chtype key) {
+  if (key != (chtype)ERR) return TRUE;
+  TextStream *stream = (TextStream *)data;
+  int eof = FALSE;
+  if (stream->follow)
+    read_text_stream(stream);
+  else if (fd_ready(stream->fd))
+    eof = !read_ready(stream->fd, read_text_batch, stream);
+  show_text_stream(stream);
+  if (!eof) return FALSE;
+  if (cdkType == vMENTRY) {
+    wtimeout(InputWindowOf((CDKMENTRY *)object), -1); // stop timing out
+    setCDKMentryPreProcess((CDKMENTRY *)object, NULL, NULL);
+  } else {
+    wtimeout(InputWindowOf((CDKBUTTONBOX *)object), -1); // stop timing out
+    setCDKButtonboxPreProcess((CDKBUTTONBOX *)object, NULL, NULL);
   }
-  // Generate the display rows, padding row items to fit column widths and
-  // separating columns with '|'s.
-  // The column headers are a special case and need to be underlined too.
-  char **new_items = malloc(sizeof(char *) * ((len + ncols - 1) / ncols + 1));
-  for (int i = -ncols; i < len; i += ncols) {
-    char *new_item = malloc((i < 0) ? row_len + 4 : row_len);
-    char *p = (i < 0) ? stpcpy_(new_item, "</U>") : new_item;
-    for (int j = i; j < i + ncols && j < len; j++) {
-      char *item = (i < 0) ? cols[j - i] : items[j];
-      p = stpcpy_(p, item);
-      int padding = col_widths[j - i] - utf8strlen(item);
-      while (padding-- > 0) *p++ = ' ';
-      *p++ = (i < 0) ? '|' : ' ';
-    }
-    if (p > new_item) *(p - 1) = '\0';
-    new_items[i / ncols + 1] = new_item;
+  return FALSE;
+}
+
+/**
+ * Shows the text already read by the given textbox stream and keeps reading it while the given
+ * textbox or button box waits for input.
+ */
+static void watch_text_stream(TextStream *stream, EObjectType cdkType, void *object) {
+  if (stream->fd < 0) return;
+  show_text_stream(stream);
+  int wait = (stream->follow && stream->notify_fd < 0) ? FOLLOW_INTERVAL : REDRAW_INTERVAL / 1000;
+  if (cdkType == vMENTRY) {
+    wtimeout(InputWindowOf((CDKMENTRY *)object), wait);
+    setCDKMentryPreProcess((CDKMENTRY *)object, textbox_load, stream);
+  } else {
+    wtimeout(InputWindowOf((CDKBUTTONBOX *)object), wait);
+    setCDKButtonboxPreProcess((CDKBUTTONBOX *)object, textbox_load, stream);
   }
-  free(col_widths);
-  return &new_items[1]; // items start here
 }
+#endif
 
-/** Signal for a scrolling keypress in the filteredlist entry. */
-static int scrolled_key(EObjectType cdkType, void *object, void *data, chtype key) {
-  HasFocusObj(ObjOf((CDKSCROLL *)data)) = TRUE; // needed to draw highlight
-  injectCDKScroll((CDKSCROLL *)data, key);
-  HasFocusObj(ObjOf((CDKSCROLL *)data)) = FALSE;
-  return TRUE;
+/**
+ * Frees the given dialog's state that its widgets do not own, and returns the given output as
+ * the dialog's result.
+ * @param context The dialog's DialogContext.
+ * @param arena The dialog's scratch memory, which *out* may be in.
+ * @param out The dialog's output.
+ * @param no_newline Whether or not to omit the result's trailing newline.
+ * @return result that should be freed by the caller
+ */
+static char *finish_dialog(DialogContext *context, Arena *arena, const char *out, int no_newline) {
+  if (context->input.buf) free(context->input.buf);
+  if (context->progress.text) free(context->progress.text);
+  if (context->tasks) free_tasks(context->tasks);
+  // Only the result outlives the dialog's arena.
+  char *result = malloc(strlen(out) + 2);
+  sprintf(result, no_newline ? "%s" : "%s\n", out);
+  free_arena(arena);
+  profile_start = 0;
+  return result;
 }
+
+/** A dialog's state from its creation until its result is taken. */
+typedef struct {
+  GTDialogType type;
+  /** Scratch memory released when the dialog finishes. */
+  Arena arena;
+  /** State the dialog's signal handlers need. */
+  DialogContext context;
+  TextStream stream;
+  /** The options and item counts the dialog's result depends on. */
+  int editable, no_newline, nrows, len, timeout_len;
+  const char *buttons[3];
+#if GTK
+  /** The asynchronous dialog this dialog was created for, or `NULL` if it is run. */
+  GTDialogAsync *async;
+  GtkWidget *dialog, *entry, **entries, *textview, *combobox, *treeview, **options;
+  FilteredList filteredlist;
+  ItemReader reader;
+  PangoFontDescription *font;
+  /** The color palette to restore after a colorselect dialog, if any. */
+  char *default_palette;
+#elif CURSES
+  int focus_textbox, select_only_dirs, height, width;
+  const char **items;
+  /** The cursor visibility to restore. */
+  int cursor;
+  /** The working directory to restore after a fileselect dialog. */
+  char cwd[FILENAME_MAX];
+  CDKSCREEN *dialog;
+  CDKLABEL *labelt, *labeli;
+  CDKENTRY *entry, **entries;
+  CDKMENTRY *textview;
+  CDKSLIDER *progressbar;
+  CDKITEMLIST *combobox;
+  CDKBUTTONBOX *buttonbox;
+  CDKSCROLL *scrolled;
+  CDKSELECTION *options;
+  CDKFSELECT *fileselect;
+  Model model;
 #endif
+} Dialog;
 
-char *gtdialog(GTDialogType type, int narg, const char *args[]) {
+/**
+ * Creates a gtdialog of the given type from the given set of parameters.
+ * The dialog is not shown yet.
+ * @param stdin_fd The file descriptor to read in place of stdin.
+ * @param result Set to the dialog's result if the parameters are invalid.
+ * @return dialog to take the result of with `dialog_result()`, or `NULL` if the parameters are
+ *   invalid
+ */
+static Dialog *create_dialog(
+  GTDialogType type, int narg, const char *args[], int stdin_fd, char **result) {
+  int64_t start = monotonic_time();
 #if (CURSES && LIBRARY && !_WIN32)
   struct termios term;
   tcgetattr(0, &term); // store initial terminal settings
@@ -496,18 +2566,37 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
 
   // Dialog options.
   int editable = FALSE, exit_onchange = FALSE, floating = FALSE, focus_textbox = FALSE,
-      font_size = 12, height = -1, no_create_dirs = FALSE, no_newline = FALSE, no_show = FALSE,
-      percent = 0, select_multiple = FALSE, select_only_dirs = FALSE, select = 0, selected = FALSE,
+      follow = FALSE, font_size = 12, fuzzy = FALSE, height = -1, items_fd = -1,
+      items_from_stdin = FALSE, max_lines = 0, no_create_dirs = FALSE, no_newline = FALSE,
+      no_show = FALSE, null_delimited = FALSE, percent = 0, search_col = 1, select_multiple = FALSE,
+      select_only_dirs = FALSE, select = 0, selected = FALSE, text_from_stdin = FALSE,
       timeout_len = 0, width = -1;
-  indeterminate = FALSE, stoppable = FALSE, string_output = FALSE;
-  output_col = 1, search_col = 1;
   const char *buttons[3] = {NULL, NULL, NULL}, **cols = NULL, *color = NULL, *font_name = NULL,
              *font_style = "", *icon = NULL, *icon_file = NULL, *info_text = NULL,
-             **info_texts = NULL, **items = NULL, *scroll_to = "top", **selects = NULL,
+             **info_texts = NULL, **items = NULL, *items_file = NULL, *items_mmap = NULL,
+             *scroll_to = "top", **selects = NULL,
              *text = NULL, **texts = NULL, *text_file = NULL, *title = "gtdialog", *with_dir = NULL,
              *with_file = NULL;
   // Other variables.
   int ncols = 0, nrows = 0, len = 0;
+  Dialog *d = calloc(1, sizeof(Dialog)); // its arena starts empty
+#if GTK
+  d->context = (DialogContext){FALSE, FALSE, FALSE, 1, NULL, NULL, stdin_fd,
+    {NULL, 0, 0, '\n', process_progressbar_input, NULL}, {FALSE, 0, NULL, 0, FALSE, -1}, NULL, NULL,
+    NULL, NULL, 0, NULL, 0, 0, NULL, NULL, NULL, 0};
+#elif CURSES
+  d->context = (DialogContext){FALSE, FALSE, FALSE, 1, NULL, NULL, stdin_fd,
+    {NULL, 0, 0, '\n', process_progressbar_input, NULL}, {FALSE, 0, NULL, 0, FALSE, -1}, NULL, NULL,
+    NULL, NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, 0, FALSE};
+#endif
+  d->context.input.userdata = &d->context;
+  if (type == GTDIALOG_PROGRESSBAR) {
+    // This dialog uses the progressbar callback, if any, so the next one will not.
+    d->context.progressbar_cb = progressbar_cb, progressbar_cb = NULL;
+    d->context.progressbar_cb_userdata = progressbar_cb_userdata, progressbar_cb_userdata = NULL;
+    d->context.stop_flag = progressbar_stop_flag, progressbar_stop_flag = NULL;
+    d->context.handle = progressbar_handle, progressbar_handle = NULL;
+  }
 #if GTK
   PangoFontDescription *font = NULL;
   GtkFileFilter *filter = NULL;
@@ -585,6 +2674,8 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
         floating = TRUE;
     } else if (strcmp(arg, "--focus-textbox") == 0) {
       if (type == GTDIALOG_TEXTBOX) focus_textbox = TRUE;
+    } else if (strcmp(arg, "--follow") == 0) {
+      if (type == GTDIALOG_TEXTBOX) follow = TRUE;
     } else if (strcmp(arg, "--font-name") == 0) {
       if (type == GTDIALOG_FONTSELECT) font_name = args[i++];
     } else if (strcmp(arg, "--font-size") == 0) {
@@ -594,6 +2685,8 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
       }
     } else if (strcmp(arg, "--font-style") == 0) {
       if (type == GTDIALOG_FONTSELECT) font_style = args[i++];
+    } else if (strcmp(arg, "--fuzzy") == 0) {
+      if (type == GTDIALOG_FILTEREDLIST) fuzzy = TRUE;
     } else if (strcmp(arg, "--height") == 0) {
       int h = atoi(args[i++]);
       if (h > 0) height = h;
@@ -602,7 +2695,7 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
     } else if (strcmp(arg, "--icon-file") == 0) {
       if (type >= GTDIALOG_MSGBOX && type <= GTDIALOG_YESNO_MSGBOX) icon_file = args[i++];
     } else if (strcmp(arg, "--indeterminate") == 0) {
-      if (type == GTDIALOG_PROGRESSBAR) indeterminate = TRUE;
+      if (type == GTDIALOG_PROGRESSBAR) d->context.indeterminate = TRUE;
     } else if (strcmp(arg, "--informative-text") == 0) {
       if (type < GTDIALOG_FILESELECT || type == GTDIALOG_TEXTBOX || type == GTDIALOG_FILTEREDLIST) {
         info_text = args[i++];
@@ -614,6 +2707,19 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
     } else if (strcmp(arg, "--items") == 0) {
       items = &args[i], len = 0;
       while (i < narg && strncmp(args[i], "--", 2) != 0) len++, i++;
+    } else if (strcmp(arg, "--items-fd") == 0) {
+      if (type == GTDIALOG_FILTEREDLIST) items_fd = atoi(args[i++]);
+    } else if (strcmp(arg, "--items-from-file") == 0) {
+      if (type == GTDIALOG_FILTEREDLIST) items_file = args[i++];
+    } else if (strcmp(arg, "--items-from-stdin") == 0) {
+      if (type == GTDIALOG_FILTEREDLIST) items_from_stdin = TRUE;
+    } else if (strcmp(arg, "--items-mmap") == 0) {
+      if (type == GTDIALOG_FILTEREDLIST) items_mmap = args[i++];
+    } else if (strcmp(arg, "--max-lines") == 0) {
+      if (type == GTDIALOG_TEXTBOX) {
+        max_lines = atoi(args[i++]);
+        if (max_lines < 0) max_lines = 0;
+      }
     } else if (strcmp(arg, "--monospaced-font") == 0) {
 #if GTK
       if (type == GTDIALOG_TEXTBOX) {
@@ -631,12 +2737,16 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
       if (type == GTDIALOG_FILESAVE) no_create_dirs = TRUE;
     } else if (strcmp(arg, "--no-newline") == 0) {
       no_newline = TRUE;
+    } else if (strcmp(arg, "--profile") == 0) {
+      if (!profile_start) profile_start = profile_last = start;
     } else if (strcmp(arg, "--no-show") == 0) {
       if (type >= GTDIALOG_INPUTBOX && type <= GTDIALOG_SECURE_STANDARD_INPUTBOX) no_show = TRUE;
+    } else if (strcmp(arg, "--null-delimited") == 0) {
+      if (type == GTDIALOG_FILTEREDLIST) null_delimited = TRUE;
     } else if (strcmp(arg, "--output-column") == 0) {
       if (type == GTDIALOG_FILTEREDLIST) {
-        output_col = atoi(args[i++]);
-        if (output_col < 1) output_col = 1;
+        d->context.output_col = atoi(args[i++]);
+        if (d->context.output_col < 1) d->context.output_col = 1;
       }
     } else if (strcmp(arg, "--palette") == 0) {
       if (type == GTDIALOG_COLORSELECT) {
@@ -666,9 +2776,12 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
     } else if (strcmp(arg, "--selected") == 0) {
       if (type == GTDIALOG_TEXTBOX) selected = TRUE;
     } else if (strcmp(arg, "--stoppable") == 0) {
-      if (type == GTDIALOG_PROGRESSBAR) stoppable = TRUE;
+      if (type == GTDIALOG_PROGRESSBAR) d->context.stoppable = TRUE;
     } else if (strcmp(arg, "--string-output") == 0) {
-      string_output = TRUE;
+      d->context.string_output = TRUE;
+    } else if (strcmp(arg, "--tasks") == 0) {
+      if (type == GTDIALOG_PROGRESSBAR && !d->context.tasks)
+        d->context.tasks = calloc(1, sizeof(Tasks));
     } else if (strcmp(arg, "--text") == 0) {
       text = args[i++];
       if (type >= GTDIALOG_INPUTBOX && type <= GTDIALOG_SECURE_STANDARD_INPUTBOX) {
@@ -677,6 +2790,8 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
       }
     } else if (strcmp(arg, "--text-from-file") == 0) {
       if (type == GTDIALOG_TEXTBOX) text_file = args[i++];
+    } else if (strcmp(arg, "--text-from-stdin") == 0) {
+      if (type == GTDIALOG_TEXTBOX) text_from_stdin = TRUE;
     } else if (strcmp(arg, "--timeout") == 0) {
       if (type != GTDIALOG_FILESELECT && type != GTDIALOG_FILESAVE && type != GTDIALOG_PROGRESSBAR)
         timeout_len = atoi(args[i++]);
@@ -709,29 +2824,79 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
     }
     arg = args[i++];
   }
-  if (output_col > ncols) output_col = ncols;
+  profile_phase("args");
+  if (d->context.output_col > ncols) d->context.output_col = ncols;
   if (search_col > ncols) search_col = ncols;
+  // Open the file descriptor to load filteredlist items from, if any.
+  int map_items_fd = items_mmap || items_fd >= 0, close_items_fd = FALSE;
+  const char *error = NULL;
+  if (type == GTDIALOG_FILTEREDLIST && ncols == 0)
+    error = "Error: --columns not given.\n";
+  else if (type == GTDIALOG_FILTEREDLIST && (items_mmap || (items_file && items_fd < 0))) {
+    if ((items_fd = open(items_mmap ? items_mmap : items_file, O_RDONLY)) >= 0)
+      close_items_fd = TRUE;
+    else if (items_mmap)
+      error = "Error: cannot open --items-mmap file.\n";
+  } else if (type == GTDIALOG_FILTEREDLIST && items_from_stdin && items_fd < 0)
+    items_fd = stdin_fd;
+#if _WIN32
+  else if (type == GTDIALOG_TEXTBOX && (follow || text_from_stdin))
+    error = "Error: --follow and --text-from-stdin are not supported on Windows.\n";
+  if (type == GTDIALOG_FILTEREDLIST && items_fd >= 0 && !error) {
+    error = "Error: --items-from-file, --items-from-stdin, --items-mmap, and --items-fd are not "
+            "supported on Windows.\n";
+    if (close_items_fd) close(items_fd);
+  }
+#endif
+  if (error) {
+#if GTK
+    if (font) pango_font_description_free(font);
+    if (filter) g_object_ref_sink(filter), g_object_unref(filter);
+#endif
+    *result = finish_dialog(&d->context, &d->arena, error, TRUE);
+    return (free(d), NULL);
+  }
+  // Open the stream to append textbox text from, if any. A followed file is read up to its end.
+#if GTK
+  d->stream = (TextStream){
+    -1, FALSE, NULL, -1, -1, TRUE, NULL, 0, 0, max_lines, 0, NULL, TRUE, 0, 0};
+#elif CURSES
+  d->stream = (TextStream){
+    -1, FALSE, NULL, -1, -1, TRUE, NULL, 0, 0, max_lines, 0, NULL, NULL, 0, 0};
+#endif
+  if (type == GTDIALOG_TEXTBOX && follow && text_file && open_text_stream(&d->stream, text_file))
+    read_text_stream(&d->stream), text_file = NULL;
+  else if (type == GTDIALOG_TEXTBOX && text_from_stdin)
+    d->stream.fd = stdin_fd;
 
     // Create dialog.
+  // Arrays of widgets are in the dialog's arena, since the widgets outlive this function.
 #if GTK
-  GtkWidget *dialog, *entry, *entries[nrows], *textview, *progressbar, *combobox, *treeview,
-    *options[nrows];
-  GtkListStore *list;
+  GtkWidget *dialog = NULL, *entry = NULL, *textview = NULL, *progressbar = NULL,
+            *combobox = NULL, *treeview = NULL;
+  GtkWidget **entries = arena_alloc(&d->arena, sizeof(GtkWidget *) * (nrows + 1)),
+            **options = arena_alloc(&d->arena, sizeof(GtkWidget *) * (len + 1));
+  d->filteredlist = (FilteredList){
+    NULL, NULL, NULL, {0}, 0, NULL, NULL, 0, 0, NULL, NULL, 0, NULL, &d->context};
+  d->reader =
+    (ItemReader){NULL, 0, 0, null_delimited ? '\0' : '\n', add_list_item, &d->filteredlist};
+  filter_init(&d->filteredlist.filter, ncols, search_col, fuzzy ? FILTER_FUZZY : FILTER_SUBSTRING);
 #elif CURSES
-  int cursor = curs_set(1); // enable cursor
-  CDKSCREEN *dialog;
-  CDKLABEL *labelt, *labeli;
-  CDKENTRY *entry, *entries[nrows + 1];
-  CDKMENTRY *textview;
-  CDKSLIDER *progressbar;
-  CDKITEMLIST *combobox;
-  CDKBUTTONBOX *buttonbox;
-  CDKSCROLL *scrolled;
-  Model model = {ncols, search_col, (char **)items, len, NULL, 0, NULL, NULL, NULL};
-  CDKSELECTION *options;
-  CDKFSELECT *fileselect;
-  char cwd[FILENAME_MAX];
-  getcwd(cwd, FILENAME_MAX);
+  d->cursor = curs_set(1); // enable cursor
+  CDKSCREEN *dialog = NULL;
+  CDKLABEL *labelt = NULL, *labeli = NULL;
+  CDKENTRY *entry = NULL, **entries = arena_alloc(&d->arena, sizeof(CDKENTRY *) * (nrows + 1));
+  CDKMENTRY *textview = NULL;
+  CDKSLIDER *progressbar = NULL;
+  CDKITEMLIST *combobox = NULL;
+  CDKBUTTONBOX *buttonbox = NULL;
+  CDKSCROLL *scrolled = NULL;
+  d->model = (Model){ncols, (char **)cols, {0}, NULL, NULL, 0, NULL, 0, 0, 0, NULL, 0, NULL, NULL,
+    -1, close_items_fd, {NULL, 0, 0, null_delimited ? '\0' : '\n', add_model_item, NULL}};
+  filter_init(&d->model.filter, ncols, search_col, fuzzy ? FILTER_FUZZY : FILTER_SUBSTRING);
+  CDKSELECTION *options = NULL;
+  CDKFSELECT *fileselect = NULL;
+  getcwd(d->cwd, FILENAME_MAX);
 #endif
   if (type != GTDIALOG_FILESELECT && type != GTDIALOG_FILESAVE && type != GTDIALOG_COLORSELECT &&
     type != GTDIALOG_FONTSELECT) {
@@ -749,7 +2914,7 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
 #endif
 #endif
     // Create buttons.
-    if (type != GTDIALOG_PROGRESSBAR || stoppable) {
+    if (type != GTDIALOG_PROGRESSBAR || d->context.stoppable) {
 #if GTK
       for (i = 3; i > 0; i--)
         if (buttons[i - 1]) gtk_dialog_add_button(GTK_DIALOG(dialog), buttons[i - 1], i);
@@ -800,14 +2965,12 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
       char **lines;
       int nlines;
       if (text) {
-        nlines = wrap((char *)text, width - 2, &lines);
+        nlines = wrap(&d->arena, (char *)text, width - 2, &lines);
         labelt = newCDKLabel(dialog, LEFT, TOP, lines, nlines, FALSE, FALSE);
-        free(lines);
       }
       if (info_text) {
-        nlines = wrap((char *)info_text, width - 2, &lines);
+        nlines = wrap(&d->arena, (char *)info_text, width - 2, &lines);
         labeli = newCDKLabel(dialog, LEFT, CENTER, lines, nlines, FALSE, FALSE);
-        free(lines);
       }
 #endif
     } else if (type >= GTDIALOG_INPUTBOX && type <= GTDIALOG_SECURE_STANDARD_INPUTBOX) {
@@ -850,16 +3013,17 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
         if (text) setCDKEntryValue(entry, (char *)text);
       } else {
         // Multiple entry inputbox.
+        d->context.entries = entries;
         for (i = 0; i < nrows; i++) {
           entries[i] =
             newCDKEntry(dialog, LEFT, (i == 0) ? TOP : i + 3, (i == 0) ? (char *)title : NULL,
               (char *)info_texts[i], A_NORMAL, '_', display, 0, 0, 100, FALSE, FALSE);
           BINDFN function = (i < nrows - 1) ? entries_tab : buttonbox_tab;
-          void *data = (i < nrows - 1) ? entries : (void *)buttonbox;
+          void *data = (i < nrows - 1) ? &d->context : (void *)buttonbox;
           bindCDKObject(vENTRY, entries[i], KEY_TAB, function, data);
           bindCDKObject(vENTRY, entries[i], KEY_DOWN, function, data);
-          bindCDKObject(vENTRY, entries[i], KEY_BTAB, entries_tab, entries);
-          bindCDKObject(vENTRY, entries[i], KEY_UP, entries_tab, entries);
+          bindCDKObject(vENTRY, entries[i], KEY_BTAB, entries_tab, &d->context);
+          bindCDKObject(vENTRY, entries[i], KEY_UP, entries_tab, &d->context);
           if (i < len) setCDKEntryValue(entries[i], (char *)texts[i]);
         }
         entries[nrows] = NULL;
@@ -880,8 +3044,13 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
       if (text) gtk_text_buffer_set_text(buffer, text, strlen(text));
 #elif CURSES
       EDisplayType display = editable ? vVIEWONLY : vMIXED;
+      // A streamed textbox holds its maximum number of lines, and keeps no more than it shows by
+      // default, as documented for --max-lines.
+      if (d->stream.fd >= 0 && !d->stream.max_lines) d->stream.max_lines = height - 8;
+      int rows =
+        (d->stream.fd >= 0 && d->stream.max_lines > height - 8) ? d->stream.max_lines : height - 8;
       textview = newCDKMentry(dialog, LEFT, TOP, (char *)title, (char *)info_text, A_NORMAL, '_',
-        display, 0, height - 8, height - 8, 0, FALSE, FALSE);
+        display, 0, height - 8, rows, 0, FALSE, FALSE);
       if (text) setCDKMentryValue(textview, (char *)text);
 #endif
       if (text_file) {
@@ -889,14 +3058,13 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
         if (f) {
           fseek(f, 0, SEEK_END);
           int len = ftell(f);
-          char *buf = malloc(len + 1);
+          char *buf = arena_alloc(&d->arena, len + 1);
           rewind(f), buf[fread(buf, 1, len, f)] = '\0';
 #if GTK
           gtk_text_buffer_set_text(buffer, buf, len);
 #elif CURSES
           setCDKMentryValue(textview, buf);
 #endif
-          free(buf);
           fclose(f);
         }
       }
@@ -908,29 +3076,66 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
       } else
         g_signal_emit_by_name(G_OBJECT(textview), "move-cursor", GTK_MOVEMENT_BUFFER_ENDS, -1, 0);
       if (selected) g_signal_emit_by_name(G_OBJECT(textview), "select-all", TRUE);
+      if (d->stream.fd >= 0)
+        d->stream.view = GTK_TEXT_VIEW(textview), watch_text_stream(&d->stream);
 #elif CURSES
       if (strcmp(scroll_to, "top") == 0)
         injectCDKMentry(textview, KEY_HOME);
       else
         injectCDKMentry(textview, KEY_END);
+      if (d->stream.fd >= 0) {
+        d->stream.view = textview, d->stream.text = copy(getCDKMentryValue(textview));
+        d->stream.text_size = (d->stream.text_len = strlen(d->stream.text)) + 1;
+      }
 #endif
     } else if (type == GTDIALOG_PROGRESSBAR) {
 #if GTK
       progressbar = gtk_progress_bar_new();
       gtk_box_pack_start(GTK_BOX(vbox), progressbar, FALSE, TRUE, 5);
-      if (!indeterminate && percent)
+      if (!d->context.indeterminate && percent)
         gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progressbar), 0.01 * percent);
-      else if (indeterminate)
+      else if (d->context.indeterminate)
         gtk_progress_bar_pulse(GTK_PROGRESS_BAR(progressbar));
       if (text) gtk_progress_bar_set_text(GTK_PROGRESS_BAR(progressbar), text);
-#elif CURSES
-      // There will be a border drawn later, but account for it now.
-      dialog = initCDKScreen(newwin(height - 2, width - 2, 2, 2));
-#if (LIBRARY && !_WIN32)
-      tcsetattr(0, TCSANOW, &term); // restore initial terminal settings
+      if (d->context.tasks) {
+        // Tasks' progressbars are added and removed as tasks start and finish.
+        GtkWidget *scrolled = gtk_scrolled_window_new(NULL, NULL);
+        d->context.task_box = gtk_vbox_new(FALSE, 0);
+#if GTK_CHECK_VERSION(3, 8, 0)
+        gtk_container_add(GTK_CONTAINER(scrolled), d->context.task_box);
+#else
+        gtk_scrolled_window_add_with_viewport(GTK_SCROLLED_WINDOW(scrolled), d->context.task_box);
 #endif
+        gtk_scrolled_window_set_policy(
+          GTK_SCROLLED_WINDOW(scrolled), GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+        if (height < 0) gtk_widget_set_size_request(scrolled, -1, 200);
+        gtk_box_pack_start(GTK_BOX(vbox), scrolled, TRUE, TRUE, 5);
+      }
+      d->context.progressbar = progressbar;
+      if (d->context.stoppable)
+        d->context.stop_button = gtk_dialog_get_widget_for_response(GTK_DIALOG(dialog), 1);
+#elif CURSES
       progressbar = newCDKSlider(dialog, LEFT, TOP, (char *)title, "", ' ' | A_REVERSE, 0, percent,
         0, 100, 1, 2, FALSE, FALSE);
+      // Pad the display text label so longer text can replace shorter text.
+      size_t line_len = width > 5 ? width - 4 : 1;
+      char *line = d->context.progress_line = arena_alloc(&d->arena, line_len + 1);
+      memset(line, ' ', line_len), line[line_len] = '\0';
+      if (text) memcpy(line, text, strlen(text) < line_len ? strlen(text) : line_len);
+      d->context.progress_label =
+        newCDKLabel(dialog, LEFT, !d->context.tasks ? CENTER : 2, &line, 1, FALSE, FALSE);
+      // Show as many tasks as fit between the display text and the "Stop" button, if any.
+      int num_lines = height - 5 - (d->context.stoppable ? 3 : 0);
+      if (d->context.tasks && num_lines > 0) {
+        d->context.task_lines = arena_alloc(&d->arena, sizeof(char *) * num_lines);
+        for (i = 0; i < num_lines; i++) {
+          d->context.task_lines[i] = memset(arena_alloc(&d->arena, line_len + 1), ' ', line_len);
+          d->context.task_lines[i][line_len] = '\0';
+        }
+        d->context.num_task_lines = num_lines, d->context.task_width = line_len;
+        d->context.task_label =
+          newCDKLabel(dialog, LEFT, 3, d->context.task_lines, num_lines, FALSE, FALSE);
+      }
 #endif
     } else if (type == GTDIALOG_DROPDOWN || type == GTDIALOG_STANDARD_DROPDOWN) {
 #if GTK
@@ -945,7 +3150,6 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
         dialog, LEFT, TOP, (char *)title, (char *)info_text, (char **)items, len, 0, FALSE, FALSE);
 #endif
     } else if (type == GTDIALOG_FILTEREDLIST) {
-      if (ncols == 0) return copy("Error: --columns not given.\n");
 #if GTK
       entry = gtk_entry_new();
       gtk_entry_set_activates_default(GTK_ENTRY(entry), TRUE);
@@ -956,53 +3160,72 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
       gtk_tree_view_set_enable_search(GTK_TREE_VIEW(treeview), TRUE);
       g_signal_connect(G_OBJECT(treeview), "key-press-event", G_CALLBACK(list_keypress), dialog);
       g_signal_connect(G_OBJECT(treeview), "row-activated", G_CALLBACK(list_select), dialog);
+      d->filteredlist.entry = GTK_ENTRY(entry), d->filteredlist.view = GTK_TREE_VIEW(treeview);
       for (i = 0; i < ncols; i++) {
         GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
-        GtkTreeViewColumn *treecol = NULL;
-        treecol = gtk_tree_view_column_new_with_attributes(cols[i], renderer, "text", i, NULL);
+        g_object_set_data(G_OBJECT(renderer), "column", GINT_TO_POINTER(i));
+        GtkTreeViewColumn *treecol =
+          gtk_tree_view_column_new_with_attributes(cols[i], renderer, NULL);
+        gtk_tree_view_column_set_cell_data_func(
+          treecol, renderer, render_list_cell, &d->filteredlist, NULL);
         gtk_tree_view_column_set_sizing(treecol, GTK_TREE_VIEW_COLUMN_AUTOSIZE);
         gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), treecol);
       }
-      GType *cols = g_new0(GType, ncols);
-      for (i = 0; i < ncols; i++) cols[i] = G_TYPE_STRING;
-      list = gtk_list_store_newv(ncols, cols);
-      free(cols);
-      GtkTreeModel *filter = gtk_tree_model_filter_new(GTK_TREE_MODEL(list), NULL);
-      gtk_tree_model_filter_set_visible_func(
-        GTK_TREE_MODEL_FILTER(filter), list_visible, (gpointer)entry, NULL);
-      gtk_tree_view_set_model(GTK_TREE_VIEW(treeview), filter);
-      g_signal_connect(G_OBJECT(entry), "key-release-event", G_CALLBACK(entry_keypress), treeview);
+      d->filteredlist.model = list_model_new(&d->filteredlist.filter.items, ncols);
+      gtk_tree_view_set_model(GTK_TREE_VIEW(treeview), GTK_TREE_MODEL(d->filteredlist.model));
+      g_signal_connect(
+        G_OBJECT(entry), "key-release-event", G_CALLBACK(entry_keypress), &d->filteredlist);
       gtk_container_add(GTK_CONTAINER(scrolled), treeview);
       if (select_multiple)
         gtk_tree_selection_set_mode(
           gtk_tree_view_get_selection(GTK_TREE_VIEW(treeview)), GTK_SELECTION_MULTIPLE);
-      if (text) gtk_entry_set_text(GTK_ENTRY(entry), text);
-      int col = 0;
-      GtkTreeIter iter;
-      for (i = 0; i < len; i++) {
-        if (col == 0) gtk_list_store_append(list, &iter);
-        gtk_list_store_set(list, &iter, col++, items[i], -1);
-        if (col == ncols) col = 0; // new row
+      if (text) gtk_entry_set_text(GTK_ENTRY(entry), text), set_list_filter(&d->filteredlist);
+      int fd =
+        filter_load(&d->filteredlist.filter, items, len, items_fd, map_items_fd, d->reader.delim);
+      if (fd < 0 && close_items_fd) close(items_fd); // mapped
+      add_list_rows(&d->filteredlist, fd < 0);
+      profile_phase("model");
+      if (fd < 0)
+        filter_index(&d->filteredlist.filter);
+      else {
+        // Stream in the remaining items in batches while the dialog is idle.
+        GIOChannel *ch = g_io_channel_unix_new(fd);
+        g_io_channel_set_close_on_unref(ch, close_items_fd);
+        stream_list_items(ch, &d->reader);
       }
 #elif CURSES
       entry = newCDKEntry(dialog, LEFT, TOP, (char *)title, (char *)info_text, A_NORMAL, '_',
         vMIXED, 0, 0, 100, FALSE, FALSE);
-      char **rows = item_rows((char **)cols, ncols, (char **)items, len);
-      int num_rows = (len + ncols - 1) / ncols; // account for non-full rows
-      scrolled = newCDKScroll(dialog, LEFT, CENTER, RIGHT, -6, 0, rows[-1], rows, num_rows, FALSE,
-        A_REVERSE, TRUE, FALSE);
-      model.rows = rows, model.num_rows = num_rows;
-      model.filtered_rows = malloc(sizeof(char *) * num_rows);
-      for (i = 0; i < num_rows; i++) model.filtered_rows[i] = model.rows[i];
-      model.entry = entry, model.scrolled = scrolled;
+      d->model.fd =
+        filter_load(&d->model.filter, items, len, items_fd, map_items_fd, d->model.reader.delim);
+      if (d->model.fd < 0 && close_items_fd) close(items_fd); // mapped
+      if (d->model.fd >= 0) {
+        // Read an initial batch of items to compute column widths from, and stream in the rest
+        // while the entry is idle.
+        d->model.reader.userdata = &d->model;
+        read_model_items(&d->model, 100);
+      }
+      add_model_rows(&d->model, d->model.fd < 0);
+      profile_phase("model");
+      scrolled = newCDKScroll(
+        dialog, LEFT, CENTER, RIGHT, -6, 0, d->model.header, NULL, 0, FALSE, A_REVERSE, TRUE,
+        FALSE);
+      d->model.entry = entry, d->model.scrolled = scrolled;
+      filter_model(&d->model);
+      if (d->model.fd >= 0) {
+        setCDKEntryPreProcess(entry, entry_load, &d->model);
+        wtimeout(InputWindowOf(entry), 0);
+      } else
+        filter_index(&d->model.filter);
       bindCDKObject(vENTRY, entry, KEY_TAB, buttonbox_tab, buttonbox);
       bindCDKObject(vENTRY, entry, KEY_BTAB, buttonbox_tab, buttonbox);
-      bindCDKObject(vENTRY, entry, KEY_UP, scrolled_key, scrolled);
-      bindCDKObject(vENTRY, entry, KEY_DOWN, scrolled_key, scrolled);
-      bindCDKObject(vENTRY, entry, KEY_PPAGE, scrolled_key, scrolled);
-      bindCDKObject(vENTRY, entry, KEY_NPAGE, scrolled_key, scrolled);
-      setCDKEntryPostProcess(entry, entry_keypress, &model);
-      // TODO: commands to scroll the list to the right and left.
+      bindCDKObject(vENTRY, entry, KEY_UP, scrolled_key, &d->model);
+      bindCDKObject(vENTRY, entry, KEY_DOWN, scrolled_key, &d->model);
+      bindCDKObject(vENTRY, entry, KEY_PPAGE, scrolled_key, &d->model);
+      bindCDKObject(vENTRY, entry, KEY_NPAGE, scrolled_key, &d->model);
+      bindCDKObject(vENTRY, entry, KEY_SLEFT, scrolled_key, &d->model);
+      bindCDKObject(vENTRY, entry, KEY_SRIGHT, scrolled_key, &d->model);
+      setCDKEntryPostProcess(entry, entry_keypress, &d->model);
       if (text) setCDKEntryValue(entry, (char *)text);
 #endif
     } else if (type == GTDIALOG_OPTIONSELECT) {
@@ -1145,49 +3368,166 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
   if (type != GTDIALOG_FILESELECT && type != GTDIALOG_FILESAVE) // cannot set for native dialogs
 #endif
     gtk_window_set_wmclass(GTK_WINDOW(dialog), "gtdialog", "gtdialog");
+#if GTK_CHECK_VERSION(3, 22, 0)
+  if (type != GTDIALOG_FILESELECT && type != GTDIALOG_FILESAVE) // native dialogs do not draw
+#endif
+    if (profile_start)
+#if GTK_CHECK_VERSION(3, 0, 0)
+      g_signal_connect_after(G_OBJECT(dialog), "draw", G_CALLBACK(profile_draw), NULL);
+#else
+      g_signal_connect_after(G_OBJECT(dialog), "expose-event", G_CALLBACK(profile_draw), NULL);
+#endif
+#endif
+  profile_phase("widgets");
+
+  d->type = type, d->editable = editable, d->no_newline = no_newline, d->nrows = nrows,
+  d->len = len, d->timeout_len = timeout_len;
+  memcpy(d->buttons, buttons, sizeof(buttons));
+#if GTK
+  d->dialog = dialog, d->entry = entry, d->entries = entries, d->textview = textview,
+  d->combobox = combobox, d->treeview = treeview, d->options = options, d->font = font,
+  d->default_palette = default_palette;
+  d->context.dialog = dialog;
+#elif CURSES
+  d->focus_textbox = focus_textbox, d->select_only_dirs = select_only_dirs, d->height = height,
+  d->width = width, d->items = items;
+  d->dialog = dialog, d->labelt = labelt, d->labeli = labeli, d->entry = entry,
+  d->entries = entries, d->textview = textview, d->progressbar = progressbar,
+  d->combobox = combobox, d->buttonbox = buttonbox, d->scrolled = scrolled, d->options = options,
+  d->fileselect = fileselect;
+#endif
+  return d;
+}
+
+#if GTK
+/**
+ * Shows the given dialog and starts updating it until it gets a response.
+ * A dialog that will be run does not need showing, and a native one must not be shown.
+ */
+static void start_dialog(Dialog *d) {
+  DialogContext *context = &d->context;
+  GtkWidget *dialog = d->dialog;
+  if (d->async) d->async->context = context;
+  if (d->type == GTDIALOG_PROGRESSBAR) {
+#ifndef LIBRARY
+    gtk_binding_entry_remove(
+      gtk_binding_set_by_class(GTK_DIALOG_GET_CLASS(dialog)), GDK_KEY_Escape, 0);
+#endif
+    gtk_widget_show_all(dialog);
+    if (context->handle && !context->progressbar_cb)
+      context->input_source = g_timeout_add(REDRAW_INTERVAL / 1000, show_progress_updates, context);
+    else if (!context->progressbar_cb) {
+#if !_WIN32
+      GIOChannel *ch = g_io_channel_unix_new(context->stdin_fd);
+#else
+      GIOChannel *ch = g_io_channel_win32_new_fd(context->stdin_fd); // TODO: test
+#endif
+      g_io_channel_set_encoding(ch, NULL, NULL), g_io_channel_set_buffered(ch, FALSE);
+      context->input_source = g_io_add_watch(ch, G_IO_IN | G_IO_HUP, read_stdin, context);
+      g_io_channel_unref(ch); // the watch holds a reference
+    } else {
+      start_progressbar_worker(context);
+      context->input_source =
+        g_timeout_add(REDRAW_INTERVAL / 1000, show_progressbar_worker_input, context);
+    }
+  } else if (d->type != GTDIALOG_FILESELECT && d->type != GTDIALOG_FILESAVE &&
+    d->type != GTDIALOG_COLORSELECT && d->type != GTDIALOG_FONTSELECT) {
+    gtk_widget_show_all(dialog);
+    if (d->timeout_len)
+      context->timeout_source = g_timeout_add_seconds(d->timeout_len, timeout_dialog, context);
+  }
+#if GTK_CHECK_VERSION(3, 20, 0)
+  else if (GTK_IS_NATIVE_DIALOG(dialog)) {
+    if (d->async) gtk_native_dialog_show(GTK_NATIVE_DIALOG(dialog));
+  }
+#endif
+  else if (d->async)
+    gtk_widget_show(dialog);
+}
+
+/**
+ * Runs the given started dialog in a nested main loop until it gets a response.
+ * @return response
+ */
+static int run_dialog(Dialog *d) {
+#if GTK_CHECK_VERSION(3, 20, 0)
+  if (GTK_IS_NATIVE_DIALOG(d->dialog)) return gtk_native_dialog_run(GTK_NATIVE_DIALOG(d->dialog));
+#endif
+  return gtk_dialog_run(GTK_DIALOG(d->dialog));
+}
+#endif
+
+/**
+ * Returns the result of the given dialog for the given response, and frees the dialog.
+ * In curses, which has no main loop, the dialog is run here first and *response* is ignored.
+ * @return result that should be freed by the caller
+ */
+static char *dialog_result(Dialog *d, int response) {
+  GTDialogType type = d->type;
+  int editable = d->editable, nrows = d->nrows, len = d->len, i;
+  const char **buttons = d->buttons;
+#if GTK
+  GtkWidget *dialog = d->dialog, *entry = d->entry, **entries = d->entries,
+            *textview = d->textview, *combobox = d->combobox, *treeview = d->treeview,
+            **options = d->options;
+  PangoFontDescription *font = d->font;
+#elif CURSES
+  int height = d->height, width = d->width;
+  const char **items = d->items;
+  CDKSCREEN *dialog = d->dialog;
+  CDKENTRY *entry = d->entry, **entries = d->entries;
+  CDKMENTRY *textview = d->textview;
+  CDKSLIDER *progressbar = d->progressbar;
+  CDKITEMLIST *combobox = d->combobox;
+  CDKBUTTONBOX *buttonbox = d->buttonbox;
+  CDKSCROLL *scrolled = d->scrolled;
+  CDKSELECTION *options = d->options;
+  CDKFSELECT *fileselect = d->fileselect;
 #endif
 
-  // Run dialog, storing output in 'out'.
+  // Take the dialog's output in 'out'.
   char *out = NULL;
   if (type != GTDIALOG_FILESELECT && type != GTDIALOG_FILESAVE && type != GTDIALOG_PROGRESSBAR &&
     type != GTDIALOG_COLORSELECT && type != GTDIALOG_FONTSELECT) {
 #if GTK
-    gtk_widget_show_all(dialog);
-    if (timeout_len) g_timeout_add_seconds(timeout_len, timeout_dialog, (gpointer)dialog);
-    int response = gtk_dialog_run(GTK_DIALOG(dialog));
+    if (d->context.timeout_source) g_source_remove(d->context.timeout_source);
     if (response == GTK_RESPONSE_DELETE_EVENT) response = RESPONSE_DELETE;
+    stop_list(&d->filteredlist), close_text_stream(&d->stream);
 #elif CURSES
     WINDOW *border = newwin(height, width, 1, 1);
     box(border, 0, 0), wrefresh(border);
     refreshCDKScreen(dialog);
-    int response;
+    profile_phase("draw");
     if (type >= GTDIALOG_INPUTBOX && type <= GTDIALOG_SECURE_STANDARD_INPUTBOX) {
       if (nrows > 1) {
         // Handle cycling through the multiple entries.
-        activateCDKEntry(focused_entry = entries[0], NULL);
-        while (focused_entry->exitType == vNORMAL || focused_entry->exitType == vNEVER_ACTIVATED) {
-          if (focused_entry->exitType == vNORMAL && focused_entry == entries[nrows - 1])
+        activateCDKEntry(d->context.focused_entry = entries[0], NULL);
+        while (d->context.focused_entry->exitType == vNORMAL ||
+          d->context.focused_entry->exitType == vNEVER_ACTIVATED) {
+          if (d->context.focused_entry->exitType == vNORMAL &&
+            d->context.focused_entry == entries[nrows - 1])
             break; // ENTER in last entry
           for (i = 0; i < nrows; i++) entries[i]->exitType = vNEVER_ACTIVATED;
-          activateCDKEntry(focused_entry, NULL);
+          activateCDKEntry(d->context.focused_entry, NULL);
         }
-        entry = focused_entry;
+        entry = d->context.focused_entry;
       } else
         activateCDKEntry(entry, NULL);
       response = (entry->exitType == vNORMAL) ? 1 + buttonbox->currentButton : RESPONSE_DELETE;
-    } else if (type == GTDIALOG_TEXTBOX && focus_textbox) {
-      activateCDKMentry(textview, NULL);
+    } else if (type == GTDIALOG_TEXTBOX && d->focus_textbox) {
+      watch_text_stream(&d->stream, vMENTRY, textview), activateCDKMentry(textview, NULL);
       response = (textview->exitType == vNORMAL) ? 1 + buttonbox->currentButton : RESPONSE_DELETE;
     } else if (type == GTDIALOG_DROPDOWN || type == GTDIALOG_STANDARD_DROPDOWN) {
       activateCDKItemlist(combobox, NULL);
       response = (combobox->exitType == vNORMAL) ? 1 + buttonbox->currentButton : RESPONSE_DELETE;
     } else if (type == GTDIALOG_FILTEREDLIST) {
-      activateCDKEntry(entry, NULL);
+      draw_model(&d->model), activateCDKEntry(entry, NULL);
       response = (entry->exitType == vNORMAL) ? 1 + buttonbox->currentButton : RESPONSE_DELETE;
     } else if (type == GTDIALOG_OPTIONSELECT) {
       activateCDKSelection(options, NULL);
       response = (options->exitType == vNORMAL) ? 1 + buttonbox->currentButton : RESPONSE_DELETE;
     } else {
+      if (type == GTDIALOG_TEXTBOX) watch_text_stream(&d->stream, vBUTTONBOX, buttonbox);
       response = 1 + activateCDKButtonbox(buttonbox, NULL);
       // activateCDKButtonbox returns -1 on escape so check for response == 0.
       if (response == 0) response = RESPONSE_DELETE;
@@ -1198,20 +3538,19 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
     delwin(border);
     destroyCDKButtonbox(buttonbox);
 #endif
-    if (string_output && response > 0 && response <= 3)
-      out = copy(buttons[response - 1]);
+    if (d->context.string_output && response > 0 && response <= 3)
+      out = (char *)buttons[response - 1];
     else
-      out = malloc(3), sprintf(out, "%i", response);
+      out = arena_printf(&d->arena, "%i", response);
     if (type <= GTDIALOG_YESNO_MSGBOX) {
 #if CURSES
-      if (text) destroyCDKLabel(labelt);
-      if (info_text) destroyCDKLabel(labeli);
+      if (d->labelt) destroyCDKLabel(d->labelt);
+      if (d->labeli) destroyCDKLabel(d->labeli);
 #endif
     } else if (type >= GTDIALOG_INPUTBOX && type != GTDIALOG_FILESELECT &&
       type != GTDIALOG_FILESAVE && type != GTDIALOG_PROGRESSBAR) {
       if (response > RESPONSE_TIMEOUT) {
         char *txt = "";
-        int created = FALSE;
         if (type <= GTDIALOG_SECURE_STANDARD_INPUTBOX) {
 #if GTK
           if (nrows > 1) {
@@ -1221,7 +3560,7 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
               g_string_append(gstr, gtk_entry_get_text(GTK_ENTRY(entries[i])));
               g_string_append_c(gstr, '\n');
             }
-            txt = copy(gstr->str), created = TRUE;
+            txt = arena_copy(&d->arena, gstr->str);
             if (strlen(txt) > 0) txt[strlen(txt) - 1] = '\0'; // chomp '\n'
             g_string_free(gstr, TRUE);
           } else
@@ -1231,12 +3570,12 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
             // Combine multiple entries into a '\n' separated string.
             int len = 1;
             for (i = 0; i < nrows; i++) len += strlen(getCDKEntryValue(entries[i])) + 1;
-            txt = malloc(len), created = TRUE;
+            txt = arena_alloc(&d->arena, len);
             char *p = txt;
             for (i = 0; i < nrows; i++) p = stpcpy_(p, getCDKEntryValue(entries[i])), *p++ = '\n';
             if (p - txt > 0) *p = '\0'; // chomp '\n'
           } else
-            txt = copy(getCDKEntryValue(entry)), created = TRUE;
+            txt = getCDKEntryValue(entry);
 #endif
         } else if (type == GTDIALOG_TEXTBOX && editable) {
 #if GTK
@@ -1245,53 +3584,47 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
           GtkTextIter s, e;
           gtk_text_buffer_get_start_iter(buffer, &s);
           gtk_text_buffer_get_end_iter(buffer, &e);
-          txt = gtk_text_buffer_get_text(buffer, &s, &e, TRUE);
+          char *text = gtk_text_buffer_get_text(buffer, &s, &e, TRUE);
+          txt = arena_copy(&d->arena, text), g_free(text);
           if (font) {
             gtk_widget_modify_font(textview, NULL);
             pango_font_description_free(font);
           }
 #elif CURSES
-          txt = copy(getCDKMentryValue(textview)), created = TRUE;
+          txt = getCDKMentryValue(textview);
 #endif
         } else if (type == GTDIALOG_DROPDOWN || type == GTDIALOG_STANDARD_DROPDOWN) {
-          if (string_output) {
+          if (d->context.string_output) {
 #if GTK
-            txt = gtk_combo_box_get_active_text(GTK_COMBO_BOX(combobox));
+            char *text = gtk_combo_box_get_active_text(GTK_COMBO_BOX(combobox));
+            if (text) txt = arena_copy(&d->arena, text), g_free(text);
 #elif CURSES
             if (len > 0) txt = (char *)items[getCDKItemlistCurrentItem(combobox)];
 #endif
-          } else {
-            txt = malloc(4), created = TRUE;
-            sprintf(txt, "%i",
+          } else
+            txt = arena_printf(&d->arena, "%i",
 #if GTK
               gtk_combo_box_get_active(GTK_COMBO_BOX(combobox)));
 #elif CURSES
               getCDKItemlistCurrentItem(combobox));
 #endif
-          }
         } else if (type == GTDIALOG_FILTEREDLIST) {
 #if GTK
-          GString *gstr = g_string_new("");
+          GString *gstr = d->filteredlist.output = g_string_new("");
           gtk_tree_selection_selected_foreach(
-            gtk_tree_view_get_selection(GTK_TREE_VIEW(treeview)), list_foreach, gstr);
-          txt = copy(gstr->str), created = TRUE;
+            gtk_tree_view_get_selection(GTK_TREE_VIEW(treeview)), list_foreach, &d->filteredlist);
+          txt = arena_copy(&d->arena, gstr->str);
           if (strlen(txt) > 0) txt[strlen(txt) - 1] = '\0'; // chomp '\n'
           g_string_free(gstr, TRUE);
 #elif CURSES
-          if (getCDKScrollItems(scrolled, NULL) > 0) {
-            i = getCDKScrollCurrentItem(scrolled);
-            if (strlen(getCDKEntryValue(entry)) > 0) {
-              char *item = model.filtered_rows[i];
-              for (int j = 0; j < model.num_rows; j++)
-                if (strcmp(item, model.rows[j]) == 0) {
-                  i = j; // non-filtered index of selected item
-                  break;
-                }
-            }
-            if (string_output) {
-              if (i * ncols + output_col - 1 < len) txt = (char *)items[i * ncols + output_col - 1];
+          if (d->model.num_filtered > 0) {
+            i = d->model.filtered[d->model.current]; // non-filtered index
+            if (d->context.string_output) {
+              size_t len = 0;
+              const char *item = filter_item(&d->model.filter, i, d->context.output_col - 1, &len);
+              if (item) txt = arena_printf(&d->arena, "%.*s", (int)len, item);
             } else
-              txt = malloc(4), sprintf(txt, "%i", i), created = TRUE;
+              txt = arena_printf(&d->arena, "%i", i);
           }
 #endif
         } else if (type == GTDIALOG_OPTIONSELECT) {
@@ -1300,13 +3633,13 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
           for (i = 0; i < len; i++) {
             GtkWidget *opt = options[i];
             if (!gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(opt))) continue;
-            if (string_output) {
+            if (d->context.string_output) {
               g_string_append(gstr, gtk_button_get_label(GTK_BUTTON(opt)));
               g_string_append_c(gstr, '\n');
             } else
               g_string_append_printf(gstr, "%i\n", i);
           }
-          txt = copy(gstr->str), created = TRUE;
+          txt = arena_copy(&d->arena, gstr->str);
           if (strlen(txt) > 0) txt[strlen(txt) - 1] = '\0'; // chomp '\n'
           g_string_free(gstr, TRUE);
 #elif CURSES
@@ -1314,11 +3647,11 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
           for (i = 0; i < len; i++)
             if (options->selections[i]) txt_len += strlen(items[i]) + 1;
           if (txt_len > 0) {
-            txt = malloc(txt_len + 1), created = TRUE;
+            txt = arena_alloc(&d->arena, txt_len + 1);
             char *p = txt;
             for (i = 0; i < len; i++)
               if (options->selections[i]) {
-                if (string_output)
+                if (d->context.string_output)
                   p = stpcpy_(p, items[i]), *p++ = '\n';
                 else
                   p += sprintf(p, "%i\n", i);
@@ -1327,159 +3660,143 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
           }
 #endif
         }
-        char *new_out = malloc(strlen(out) + strlen(txt) + 2);
-        sprintf(new_out, "%s\n%s", out, txt);
-        free(out);
-        out = new_out;
-        if (created) free(txt);
+        out = arena_printf(&d->arena, "%s\n%s", out, txt);
       }
     }
   } else if (type == GTDIALOG_FILESELECT || type == GTDIALOG_FILESAVE) {
 #if GTK
-#if GTK_CHECK_VERSION(3, 22, 0)
-    int response = gtk_native_dialog_run(GTK_NATIVE_DIALOG(dialog));
-#else
-    int response = gtk_dialog_run(GTK_DIALOG(dialog));
-#endif
     if (response == GTK_RESPONSE_ACCEPT) {
       GtkFileChooser *chooser = GTK_FILE_CHOOSER(dialog);
       if (type == GTDIALOG_FILESELECT && gtk_file_chooser_get_select_multiple(chooser)) {
-        out = copy("");
+        GString *gstr = g_string_new("");
         GSList *filenames = gtk_file_chooser_get_filenames(chooser), *i = NULL;
         for (i = filenames; i; i = i->next) {
-          char *new_out = g_strconcat(out, "\n", (char *)i->data, NULL);
-          free(out), g_free(i->data);
-          out = new_out;
+          g_string_append_c(gstr, '\n'), g_string_append(gstr, (char *)i->data);
+          g_free(i->data);
         }
         g_slist_free(filenames);
-      } else
-        out = copy(gtk_file_chooser_get_filename(chooser));
+        out = arena_copy(&d->arena, gstr->str);
+        g_string_free(gstr, TRUE);
+      } else {
+        char *filename = gtk_file_chooser_get_filename(chooser);
+        out = arena_copy(&d->arena, filename), g_free(filename);
+      }
     } else
-      out = copy("");
+      out = "";
 #elif CURSES
     char *txt = activateCDKFselect(fileselect, NULL);
-    if (select_only_dirs) txt = getCDKFselectDirectory(fileselect);
-    out = txt ? copy(txt) : copy("");
+    if (d->select_only_dirs) txt = getCDKFselectDirectory(fileselect);
+    out = txt ? arena_copy(&d->arena, txt) : "";
     destroyCDKFselect(fileselect);
-    chdir(cwd);
+    chdir(d->cwd);
 #endif
   } else if (type == GTDIALOG_PROGRESSBAR) {
 #if GTK
-#ifndef LIBRARY
-    gtk_binding_entry_remove(
-      gtk_binding_set_by_class(GTK_DIALOG_GET_CLASS(dialog)), GDK_KEY_Escape, 0);
-#endif
-    gtk_widget_show_all(GTK_WIDGET(dialog));
-    if (!progressbar_cb) {
-#if !_WIN32
-      GIOChannel *ch = g_io_channel_unix_new(0);
-#else
-      GIOChannel *ch = g_io_channel_win32_new_fd(0); // TODO: test
-#endif
-      g_io_channel_set_encoding(ch, NULL, NULL);
-      int source = g_io_add_watch(ch, G_IO_IN | G_IO_HUP, read_stdin, dialog);
-      if (gtk_dialog_run(GTK_DIALOG(dialog)) != 1)
-        out = copy("");
-      else {
-        out = copy("stopped");
-        g_source_remove(source);
-      }
-      g_io_channel_unref(ch), g_io_channel_unref(ch);
-    } else {
-      int source = g_timeout_add(0, call_progressbar_callback, dialog);
-      if (gtk_dialog_run(GTK_DIALOG(dialog)) != 1)
-        out = copy("");
-      else {
-        out = copy("stopped");
-        g_source_remove(source);
-      }
-      progressbar_cb = NULL, progressbar_cb_userdata = NULL;
-    }
+    out = response != 1 ? "" : "stopped";
+    if (d->context.input_source) g_source_remove(d->context.input_source);
+    if (d->context.handle && !d->context.progressbar_cb)
+      stop_progress_updates(&d->context);
+    else if (d->context.progressbar_cb)
+      stop_progressbar_worker(&d->context);
+    if (d->context.redraw_source) g_source_remove(d->context.redraw_source);
 #elif CURSES
-    if (progressbar_cb) {
-      WINDOW *border = newwin(height, width, 1, 1);
-      box(border, 0, 0), wrefresh(border);
-      refreshCDKScreen(dialog);
-      if (stoppable) drawCDKButtonbox(buttonbox, TRUE);
-      int stop_enabled = stoppable;
-      char *input;
-      while ((input = progressbar_cb(progressbar_cb_userdata))) {
-        char *p = input;
-        while (!isspace(*p)) p++;
-        *p = '\0', p[strlen(p + 1)] = '\0'; // chomp '\n'
-        if (!indeterminate) setCDKSliderValue(progressbar, atoi(input));
-        if (*(p + 1)) {
-          if (stoppable) {
-            if (strcmp(p + 1, "stop enable") == 0) {
-              stop_enabled = TRUE;
-              setCDKButtonboxHighlight(buttonbox, A_REVERSE);
-            } else if (strcmp(p + 1, "stop disable") == 0) {
-              stop_enabled = FALSE;
-              setCDKButtonboxHighlight(buttonbox, A_NORMAL);
-            }
-            // TODO: set text p + 1
-          }
-          // TODO: set text p + 1
+    WINDOW *border = newwin(height, width, 1, 1);
+    box(border, 0, 0), wrefresh(border);
+    refreshCDKScreen(dialog);
+    profile_phase("draw");
+    d->context.progressbar = progressbar;
+    d->context.buttonbox = d->context.stoppable ? buttonbox : NULL;
+    d->context.stop_enabled = d->context.stoppable;
+    if (d->context.progressbar_cb) {
+      start_progressbar_worker(&d->context);
+      while (!progressbar_worker_finished(&d->context)) {
+        // Wait for a key press until it is time to redraw, unless there is work to do here.
+        timeout(d->context.worker->started ? REDRAW_INTERVAL / 1000 : 0);
+        int key = getch();
+        timeout(-1);
+        if (stops_progressbar(&d->context, key)) {
+          out = "stopped";
+          break;
         }
-        free(input);
-        timeout(0);
+        lock_progressbar_input(&d->context), show_progressbar_input(&d->context);
+        unlock_progressbar_input(&d->context);
+      }
+      stop_progressbar_worker(&d->context);
+    } else if (d->context.handle) {
+      while (TRUE) {
+        int finished = take_progress_updates(&d->context);
+        show_progressbar_input(&d->context); // the final update too
+        if (finished) break;
+        // Wait for a key press until it is time to redraw.
+        timeout(REDRAW_INTERVAL / 1000);
         int key = getch();
         timeout(-1);
-        if ((key == KEY_ENTER || key == '\n') && stop_enabled) {
-          out = copy("stopped");
+        if (stops_progressbar(&d->context, key)) {
+          out = "stopped";
           break;
         }
-        refreshCDKScreen(dialog);
-        if (stoppable) drawCDKButtonbox(buttonbox, TRUE);
       }
-      wborder(border, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '), wrefresh(border);
-      delwin(border);
-      destroyCDKSlider(progressbar);
-      destroyCDKButtonbox(buttonbox);
+      stop_progress_updates(&d->context);
     }
-    if (!out) out = copy("");
+#if !_WIN32
+    else if (!isatty(d->context.stdin_fd) && run_progressbar_input(&d->context))
+      out = "stopped";
+#endif
+    wborder(border, ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' '), wrefresh(border);
+    delwin(border);
+    destroyCDKSlider(progressbar), destroyCDKLabel(d->context.progress_label);
+    if (d->context.task_label) destroyCDKLabel(d->context.task_label);
+    if (d->context.stoppable) destroyCDKButtonbox(buttonbox);
+    if (!out) out = "";
 #endif
   } else if (type == GTDIALOG_COLORSELECT) {
 #if GTK
-    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+    if (response == GTK_RESPONSE_OK) {
       GtkColorSelectionDialog *dlg = GTK_COLOR_SELECTION_DIALOG(dialog);
       GtkWidget *sel = gtk_color_selection_dialog_get_color_selection(dlg);
       GdkColor gdk_color;
       gtk_color_selection_get_current_color(GTK_COLOR_SELECTION(sel), &gdk_color);
-      out = malloc(8);
-      sprintf(
-        out, "#%02X%02X%02X", gdk_color.red / 256, gdk_color.green / 256, gdk_color.blue / 256);
+      out = arena_printf(&d->arena, "#%02X%02X%02X", gdk_color.red / 256, gdk_color.green / 256,
+        gdk_color.blue / 256);
     } else
-      out = copy("");
-    if (default_palette)
+      out = "";
+    if (d->default_palette)
       gtk_settings_set_string_property(gtk_settings_get_default(), "gtk-color-palette",
-        default_palette,
+        d->default_palette,
         "XProperty"); // restore default
 #elif CURSES
     // TODO:
-    out = copy("");
+    out = "";
 #endif
   } else if (type == GTDIALOG_FONTSELECT) {
 #if GTK
-    if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_OK) {
+    if (response == GTK_RESPONSE_OK) {
       GtkFontSelectionDialog *dlg = GTK_FONT_SELECTION_DIALOG(dialog);
-      out = copy(gtk_font_selection_dialog_get_font_name(dlg));
+      char *font_name = gtk_font_selection_dialog_get_font_name(dlg);
+      out = arena_copy(&d->arena, font_name), g_free(font_name);
     } else
-      out = copy("");
+      out = "";
 #elif CURSES
     // TODO:
-    out = copy("");
+    out = "";
 #endif
   }
-  if (strcmp(out, "0") == 0 && string_output)
-    out = copy("timeout");
-  else if (strcmp(out, "-1") == 0 && string_output)
-    out = copy("delete");
+  profile_phase("response");
+#if GTK
+  if (d->async) d->async->context = NULL;
+#endif
+  if (strcmp(out, "0") == 0 && d->context.string_output)
+    out = "timeout";
+  else if (strcmp(out, "-1") == 0 && d->context.string_output)
+    out = "delete";
 #if GTK
 #if GTK_CHECK_VERSION(3, 22, 0)
   if (type != GTDIALOG_FILESELECT && type != GTDIALOG_FILESAVE) // cannot destroy native dialogs
 #endif
     gtk_widget_destroy(dialog);
+  if (d->reader.buf) free(d->reader.buf);
+  if (d->filteredlist.model) g_object_unref(d->filteredlist.model);
+  filter_free(&d->filteredlist.filter);
 #elif CURSES
   if (type <= GTDIALOG_SECURE_STANDARD_INPUTBOX) {
     if (nrows < 2)
@@ -1487,29 +3804,101 @@ char *gtdialog(GTDialogType type, int narg, const char *args[]) {
     else
       for (i = 0; i < nrows; i++) destroyCDKEntry(entries[i]);
   } else if (type == GTDIALOG_TEXTBOX)
-    destroyCDKMentry(textview);
+    destroyCDKMentry(textview), close_text_stream(&d->stream);
   else if (type == GTDIALOG_DROPDOWN || type == GTDIALOG_STANDARD_DROPDOWN)
     destroyCDKItemlist(combobox);
   else if (type == GTDIALOG_FILTEREDLIST) {
     destroyCDKEntry(entry), destroyCDKScroll(scrolled);
-    if (model.rows) {
-      for (i = -1; i < model.num_rows; i++) free(model.rows[i]);
-      free(&model.rows[-1]);
-    }
-    if (model.filtered_rows) free(model.filtered_rows);
+    free(d->model.header);
+    if (d->model.col_widths) free(d->model.col_widths);
+    free(d->model.widths);
+    if (d->model.fd >= 0 && d->model.close_fd) close(d->model.fd);
+    if (d->model.reader.buf) free(d->model.reader.buf);
   } else if (type == GTDIALOG_OPTIONSELECT)
     destroyCDKSelection(options);
+  filter_free(&d->model.filter); // initialized for every dialog type
   delwin(dialog->window), destroyCDKScreen(dialog);
-  curs_set(cursor); // restore cursor
+  curs_set(d->cursor); // restore cursor
   timeout(0), getch(), timeout(-1); // flush input
 #endif
-  if (!no_newline) {
-    char *new_out = malloc(strlen(out) + 2);
-    sprintf(new_out, "%s\n", out);
-    free(out);
-    out = new_out;
-  }
-  return out;
+  char *result = finish_dialog(&d->context, &d->arena, out, d->no_newline);
+  return (free(d), result);
+}
+
+char *gtdialog(GTDialogType type, int narg, const char *args[]) {
+  char *result = NULL;
+  Dialog *d = create_dialog(type, narg, args, 0, &result);
+  if (!d) return result;
+#if GTK
+  start_dialog(d);
+  return dialog_result(d, run_dialog(d));
+#elif CURSES
+  return dialog_result(d, 0);
+#endif
+}
+
+#if GTK
+/** Passes the given result to the given asynchronous dialog's callback and frees the dialog. */
+static void finish_async(GTDialogAsync *async, char *result) {
+  async->callback(result, async->userdata);
+  for (int i = 0; i < async->narg; i++) free(async->args[i]);
+  free(async->args), free(async);
+}
+
+/** Signal for an asynchronous dialog's response, which finishes the dialog. */
+static void async_response(gpointer instance, int response, gpointer userdata) {
+  Dialog *d = (Dialog *)userdata;
+  GTDialogAsync *async = d->async;
+  finish_async(async, dialog_result(d, response));
+}
+
+/** Idle function for showing an asynchronous dialog from the host's main loop. */
+static gboolean show_async(gpointer userdata) {
+  GTDialogAsync *async = (GTDialogAsync *)userdata;
+  async->source = 0;
+  char *result = NULL;
+  Dialog *d = create_dialog(
+    async->type, async->narg, (const char **)async->args, async->stdin_fd, &result);
+  if (!d) return (finish_async(async, result), FALSE);
+  d->async = async;
+  g_signal_connect(G_OBJECT(d->dialog), "response", G_CALLBACK(async_response), d);
+  return (start_dialog(d), FALSE);
+}
+
+/**
+ * Shows a dialog like `gtdialog_async()` does, but reads the given file descriptor in place of
+ * stdin.
+ */
+static GTDialogAsync *show_dialog_async(GTDialogType type, int narg, const char *args[],
+  int stdin_fd, void (*callback)(char *, void *), void *userdata) {
+  GTDialogAsync *async = calloc(1, sizeof(GTDialogAsync));
+  async->type = type, async->narg = narg, async->callback = callback, async->userdata = userdata;
+  async->args = malloc(sizeof(char *) * (narg > 0 ? narg : 1));
+  for (int i = 0; i < narg; i++) async->args[i] = copy(args[i]);
+  async->stdin_fd = stdin_fd, async->source = g_idle_add(show_async, async);
+  return async;
+}
+#endif
+
+GTDialogAsync *gtdialog_async(GTDialogType type, int narg, const char *args[],
+  void (*callback)(char *, void *), void *userdata) {
+#if GTK
+  return show_dialog_async(type, narg, args, 0, callback, userdata);
+#elif CURSES
+  // There is no main loop to return to, so show the dialog now.
+  callback(gtdialog(type, narg, args), userdata);
+  return NULL;
+#endif
+}
+
+void gtdialog_cancel(GTDialogAsync *async) {
+#if GTK
+  if (!async) return;
+  if (async->source)
+    g_source_remove(async->source), async->source = 0, finish_async(async, NULL);
+  else if (async->context)
+    close_dialog(async->context);
+#endif
 }
 
 // clang-format off
@@ -1569,7 +3958,19 @@ HELP_DROPDOWN HELP_FILTEREDLIST HELP_OPTIONSELECT HELP_COLORSELECT \
 HELP_FONTSELECT \
 "\n" \
 "gtdialog help type\n" \
-"   Shows detailed documentation on gtdialog type\n"
+"   Shows detailed documentation on gtdialog type\n" \
+HELP_SERVER
+#if (GTK && !_WIN32)
+#define HELP_SERVER \
+"gtdialog --server socket\n" \
+"   Runs a dialog server that listens on Unix socket path socket and\n" \
+"   shows dialogs requested by clients\n" \
+"gtdialog --client socket type [args]\n" \
+"   Shows dialog type on the dialog server listening on socket, or shows\n" \
+"   it directly if there is no server\n"
+#else
+#define HELP_SERVER ""
+#endif
 
 // Help on dialog arguments.
 #define HELP_DEFAULT_ARGS \
@@ -1583,7 +3984,9 @@ HELP_FONTSELECT \
 "  --width int\n" \
 "      Manually set the width of the dialog in pixels if possible.\n" \
 "  --height int\n" \
-"      Manually set the height of the dialog in pixels if possible.\n"
+"      Manually set the height of the dialog in pixels if possible.\n" \
+"  --profile\n" \
+"      Write the time taken by each phase of showing the dialog to stderr.\n"
 #define HELP_TEXT_MAIN \
 "  --text str\n" \
 "      The main message text.\n"
@@ -1685,6 +4088,22 @@ HELP_FONTSELECT \
 "  --text-from-file str\n" \
 "      The filename whose contents are loaded into the textbox.\n" \
 "      Has no effect when --text is present.\n"
+#define HELP_FOLLOW \
+"  --follow\n" \
+"      Keep appending text to the textbox as the --text-from-file file grows,\n" \
+"      like “tail -f”. The file is read from its start again if it is\n" \
+"      truncated, and a file that replaces it, as after log rotation, is\n" \
+"      followed instead. Not supported on Windows.\n"
+#define HELP_TEXT_FROM_STDIN \
+"  --text-from-stdin\n" \
+"      Append text read from standard input (stdin) to the textbox as it is\n" \
+"      read. Has no effect with --follow. Not supported on Windows.\n"
+#define HELP_MAX_LINES \
+"  --max-lines int\n" \
+"      The maximum number of lines to keep in the textbox when appending text\n" \
+"      with --follow or --text-from-stdin. Older lines are dropped. There is\n" \
+"      no limit by default in the GUI version; the terminal version keeps only\n" \
+"      the lines its textbox shows.\n"
 #define HELP_BUTTON1 \
 "  --button1 str\n" \
 "      The right-most button's label.\n"
@@ -1716,13 +4135,18 @@ HELP_FONTSELECT \
 "      The initial progressbar percentage between 0 and 100.\n"
 #define HELP_TEXT_PROGRESSBAR \
 "  --text str\n" \
-"      The initial progressbar display text. (GTK only.)\n"
+"      The initial progressbar display text.\n"
 #define HELP_INDETERMINATE \
 "  --indeterminate\n" \
 "      Show the progressbar as “busy” with no percentage updates.\n"
 #define HELP_STOPPABLE \
 "  --stoppable\n" \
 "      Show the Stop button.\n"
+#define HELP_TASKS \
+"  --tasks\n" \
+"      Read lines of the form “id num str\\n” that update the progress of the\n" \
+"      task with ID “id”, and show each unfinished task's progress along with\n" \
+"      the overall progress.\n"
 #define HELP_ITEMS_DROPDOWN \
 "  --items list\n" \
 "      The list of items to show in the drop down. Each item must be a\n" \
@@ -1752,6 +4176,32 @@ HELP_FONTSELECT \
 "      The items to show in the list. Each item must be a separate argument\n" \
 "      and is inserted into the first empty column in the current list row.\n" \
 "      Requires --columns.\n"
+#define HELP_ITEMS_FROM_FILE \
+"  --items-from-file str\n" \
+"      The file to read additional list items from, one item per line. Items\n" \
+"      are shown as they are read. Not supported on Windows.\n" \
+"      Requires --columns.\n"
+#define HELP_ITEMS_FROM_STDIN \
+"  --items-from-stdin\n" \
+"      Read additional list items from standard input (stdin), one item per\n" \
+"      line. Items are shown as they are read. Not supported on Windows.\n" \
+"      Requires --columns.\n"
+#define HELP_ITEMS_MMAP \
+"  --items-mmap str\n" \
+"      The file to memory-map list items from, one item per line. Items are\n" \
+"      used in place and replace any --items. Falls back to --items-from-file\n" \
+"      when the file cannot be mapped. Not supported on Windows.\n" \
+"      Requires --columns.\n"
+#define HELP_ITEMS_FD \
+"  --items-fd int\n" \
+"      The open file descriptor to load list items from, one item per line.\n" \
+"      A regular file is memory-mapped like --items-mmap. Otherwise items are\n" \
+"      streamed like --items-from-stdin. Not supported on Windows.\n" \
+"      Requires --columns.\n"
+#define HELP_NULL_DELIMITED \
+"  --null-delimited\n" \
+"      Items read from a file, file descriptor, or stdin are delimited by NUL\n" \
+"      characters instead of newlines.\n"
 #define HELP_SELECT_MULTIPLE_FILTEREDLIST \
 "  --select-multiple\n" \
 "      Enable multiple item selection.\n"
@@ -1760,6 +4210,11 @@ HELP_FONTSELECT \
 "      The column number to filter the input text against. The default is\n" \
 "      1.\n" \
 "      Requires --columns.\n"
+#define HELP_FUZZY \
+"  --fuzzy\n" \
+"      Match each word of the input text, in any order, as a subsequence of\n" \
+"      characters rather than as a substring, and list the best matches\n" \
+"      first (e.g. at word or path boundaries and in consecutive runs).\n"
 #define HELP_OUTPUT_COLUMN \
 "  --output-column int\n" \
 "      The column number to use for --string-output. The default is 1.\n"
@@ -1981,6 +4436,9 @@ int help(int argc, char *argv[]) {
       HELP_INFORMATIVE_TEXT_TEXTBOX
       HELP_TEXT_TEXTBOX
       HELP_TEXT_FROM_FILE
+      HELP_FOLLOW
+      HELP_TEXT_FROM_STDIN
+      HELP_MAX_LINES
       HELP_BUTTON1
       HELP_BUTTON2
       HELP_BUTTON3
@@ -2003,6 +4461,7 @@ int help(int argc, char *argv[]) {
       HELP_TEXT_PROGRESSBAR
       HELP_INDETERMINATE
       HELP_STOPPABLE
+      HELP_TASKS
       HELP_FLOAT,
       HELP_PROGRESSBAR_RETURN,
       HELP_PROGRESSBAR_EXAMPLE));
@@ -2035,11 +4494,17 @@ int help(int argc, char *argv[]) {
       HELP_TEXT_FILTEREDLIST
       HELP_COLUMNS
       HELP_ITEMS_FILTEREDLIST
+      HELP_ITEMS_FROM_FILE
+      HELP_ITEMS_FROM_STDIN
+      HELP_ITEMS_MMAP
+      HELP_ITEMS_FD
+      HELP_NULL_DELIMITED
       HELP_BUTTON1
       HELP_BUTTON2
       HELP_BUTTON3
       HELP_SELECT_MULTIPLE_FILTEREDLIST
       HELP_SEARCH_COLUMN
+      HELP_FUZZY
       HELP_OUTPUT_COLUMN
       HELP_FLOAT HELP_TIMEOUT,
       HELP_FILTEREDLIST_RETURN
@@ -2093,6 +4558,260 @@ int help(int argc, char *argv[]) {
   return 1;
 }
 
+#if (GTK && !LIBRARY && !_WIN32)
+/** The path of the socket the dialog server listens on. */
+static const char *server_socket;
+
+/**
+ * Returns a Unix socket for the given path, or -1 if the path is too long.
+ * @param path The socket's path.
+ * @param addr The address to fill in for the socket.
+ */
+static int unix_socket(const char *path, struct sockaddr_un *addr) {
+  if (strlen(path) >= sizeof(addr->sun_path)) return -1;
+  memset(addr, 0, sizeof(struct sockaddr_un));
+  addr->sun_family = AF_UNIX, strcpy(addr->sun_path, path);
+  return socket(AF_UNIX, SOCK_STREAM, 0);
+}
+
+/**
+ * Connects to the dialog server listening on the given socket and returns the connection, or
+ * returns -1 if no server is listening there.
+ * @param path The server socket's path.
+ */
+static int connect_server(const char *path) {
+  struct sockaddr_un addr;
+  int fd = unix_socket(path, &addr);
+  if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) close(fd), fd = -1;
+  return fd;
+}
+
+/**
+ * Writes all of the given bytes to a socket connection.
+ * Returns `TRUE` on success, or `FALSE` if the connection was lost.
+ * @param fd The socket connection.
+ * @param s The bytes to write.
+ * @param len The number of bytes to write.
+ */
+static int send_all(int fd, const char *s, size_t len) {
+  for (ssize_t n; len > 0; s += n, len -= n)
+    if ((n = send(fd, s, len, MSG_NOSIGNAL)) <= 0) return FALSE;
+  return TRUE;
+}
+
+/**
+ * Forwards a dialog to the dialog server listening on the given socket and prints the dialog's
+ * output like a locally shown dialog would.
+ * The request is the dialog type and its arguments, each NUL-terminated. This process's stdin is
+ * passed along with it so the server can read progressbar updates and filteredlist items from it.
+ * The server ends the dialog's output with a NUL byte, so output without one means the server
+ * went away before the dialog finished.
+ * Returns the exit status to exit with, or -1 if no server is listening on the socket.
+ * @param path The server socket's path.
+ * @param argc The number of dialog arguments, including the dialog type.
+ * @param argv The dialog type followed by its arguments.
+ */
+static int request_dialog(const char *path, int argc, char *argv[]) {
+  int fd = connect_server(path), i;
+  if (fd < 0) return -1;
+  size_t len = 0, n;
+  for (i = 0; i < argc; i++) len += strlen(argv[i]) + 1;
+  char *request = malloc(len), *p = request;
+  for (i = 0; i < argc; i++) n = strlen(argv[i]) + 1, memcpy(p, argv[i], n), p += n;
+  // Send the first byte along with stdin, then the rest.
+  char control[CMSG_SPACE(sizeof(int))];
+  struct iovec iov = {request, 1};
+  struct msghdr msg = {NULL, 0, &iov, 1, control, sizeof(control), 0};
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET, cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  int stdin_fd = 0;
+  memcpy(CMSG_DATA(cmsg), &stdin_fd, sizeof(int));
+  if (fcntl(0, F_GETFD) < 0) msg.msg_control = NULL, msg.msg_controllen = 0; // stdin closed
+  int sent = sendmsg(fd, &msg, MSG_NOSIGNAL) == 1 && send_all(fd, request + 1, len - 1);
+  free(request);
+  if (!sent) return (close(fd), -1);
+  shutdown(fd, SHUT_WR);
+  // Read and print the dialog's output.
+  size_t size = 1024;
+  char *out = malloc(size);
+  ssize_t nread;
+  for (n = 0; (nread = read(fd, out + n, size - n - 1)) > 0;)
+    if ((n += nread) == size - 1) out = realloc(out, size *= 2);
+  out[n] = '\0';
+  close(fd);
+  int finished = n > 0 && strlen(out) == n - 1;
+  if (finished)
+    puts(out);
+  else
+    fprintf(stderr, "gtdialog: lost connection to the dialog server\n");
+  free(out);
+  return finished ? 0 : 1;
+}
+
+/** Signal handler that removes the dialog server's socket before exiting. */
+static void stop_server(int sig) { unlink(server_socket), signal(sig, SIG_DFL), raise(sig); }
+
+/** The number of seconds a client has to send its dialog request before it is dropped. */
+#define REQUEST_TIMEOUT 10
+
+/** A client of the dialog server. */
+typedef struct Client {
+  /** The client's connection. */
+  int fd;
+  /** The client's stdin, or -1. */
+  int stdin_fd;
+  /** The request read so far, its length, and the allocated size of its buffer. */
+  char *request;
+  size_t len, size;
+  /** The ID of the source that reads the request, or that watches for the client hanging up
+   * once it has been read, or 0. */
+  guint source;
+  /** The ID of the source that drops a slow client, or 0. */
+  guint timeout_source;
+  /** The client's dialog, or `NULL`. */
+  GTDialogAsync *dialog;
+} Client;
+
+/** Disconnects the given dialog server client and frees it. */
+static void free_client(Client *client) {
+  if (client->source) g_source_remove(client->source);
+  if (client->timeout_source) g_source_remove(client->timeout_source);
+  if (client->stdin_fd >= 0) close(client->stdin_fd);
+  close(client->fd), free(client->request), free(client);
+}
+
+/**
+ * Sends the given dialog output back to the dialog server client given as userdata, and frees the
+ * client.
+ * @param out The dialog's output, or `NULL` if the dialog was cancelled before being shown.
+ */
+static void reply_client(char *out, void *userdata) {
+  Client *client = (Client *)userdata;
+  client->dialog = NULL;
+  if (out) send_all(client->fd, out, strlen(out) + 1); // the NUL tells the client it finished
+  free(out), free_client(client);
+}
+
+/**
+ * Signal for a dialog server client hanging up before its dialog finished, which cancels the
+ * dialog.
+ * @param userdata The Client.
+ */
+static gboolean hang_up(GIOChannel *channel, GIOCondition condition, gpointer userdata) {
+  Client *client = (Client *)userdata;
+  client->source = 0;
+  return (gtdialog_cancel(client->dialog), FALSE); // frees the client
+}
+
+/**
+ * Shows the given dialog server client's requested dialog without waiting for it to finish.
+ * The dialog reads the client's stdin in place of the server's, so dialogs from any number of
+ * clients can show at once. Its output is sent back to the client when it finishes. A client
+ * that hangs up before then, even while its dialog is still waiting to be shown, cancels it.
+ */
+static void show_request(Client *client) {
+  const char **argv = malloc((client->len + 1) * sizeof(char *));
+  char *request = client->request, *p, *end;
+  int argc = 0;
+  for (p = request; (end = memchr(p, '\0', request + client->len - p)); p = end + 1)
+    argv[argc++] = p;
+  int type = argc > 0 ? gtdialog_type(argv[0]) : GTDIALOG_UNKNOWN;
+  if (type == GTDIALOG_UNKNOWN) {
+    free(argv), reply_client(copy("Error: unknown dialog type.\n"), client);
+    return;
+  }
+  if (client->stdin_fd < 0) client->stdin_fd = open("/dev/null", O_RDONLY);
+  GIOChannel *ch = g_io_channel_unix_new(client->fd);
+  client->source = g_io_add_watch(ch, G_IO_HUP | G_IO_ERR, hang_up, client); // not its EOF
+  g_io_channel_unref(ch); // the watch holds a reference
+  client->dialog =
+    show_dialog_async(type, argc - 1, &argv[1], client->stdin_fd, reply_client, client);
+  free(argv);
+}
+
+/**
+ * Signal for a dialog server client's request being readable.
+ * Reads what is available without blocking. Once the client finishes sending its request, its
+ * dialog is shown.
+ * @param userdata The Client.
+ */
+static gboolean read_request(GIOChannel *channel, GIOCondition condition, gpointer userdata) {
+  Client *client = (Client *)userdata;
+  char control[CMSG_SPACE(sizeof(int))];
+  ssize_t n;
+  do {
+    if (client->len == client->size)
+      client->request = realloc(client->request, client->size *= 2);
+    struct iovec iov = {client->request + client->len, client->size - client->len};
+    struct msghdr msg = {NULL, 0, &iov, 1, control, sizeof(control), 0};
+    if ((n = recvmsg(client->fd, &msg, MSG_DONTWAIT)) > 0) client->len += n;
+    struct cmsghdr *cmsg = n >= 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+      client->stdin_fd < 0)
+      memcpy(&client->stdin_fd, CMSG_DATA(cmsg), sizeof(int));
+  } while (n > 0);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return TRUE;
+  client->source = 0;
+  if (n < 0) return (free_client(client), FALSE); // connection lost
+  g_source_remove(client->timeout_source), client->timeout_source = 0;
+  return (show_request(client), FALSE);
+}
+
+/**
+ * Timeout function for dropping a dialog server client that did not send its request in time.
+ * @param userdata The Client.
+ */
+static gboolean drop_client(gpointer userdata) {
+  Client *client = (Client *)userdata;
+  client->timeout_source = 0;
+  return (free_client(client), FALSE);
+}
+
+/**
+ * Signal for a client connecting to the dialog server.
+ * The client's request is read as it arrives, so one client cannot keep others from connecting.
+ */
+static gboolean serve_request(GIOChannel *channel, GIOCondition condition, gpointer userdata) {
+  int fd = accept(g_io_channel_unix_get_fd(channel), NULL, NULL);
+  if (fd < 0) return TRUE;
+  Client *client = calloc(1, sizeof(Client));
+  client->fd = fd, client->stdin_fd = -1, client->request = malloc(client->size = 1024);
+  GIOChannel *ch = g_io_channel_unix_new(fd);
+  client->source = g_io_add_watch(ch, G_IO_IN | G_IO_HUP, read_request, client);
+  g_io_channel_unref(ch); // the watch holds a reference
+  client->timeout_source = g_timeout_add_seconds(REQUEST_TIMEOUT, drop_client, client);
+  return TRUE;
+}
+
+/**
+ * Runs a dialog server that listens on the given socket and shows requested dialogs until it is
+ * terminated.
+ * Returns non-zero if the server could not be started.
+ * @param path The path of the socket to listen on.
+ */
+static int serve(const char *path) {
+  struct sockaddr_un addr;
+  int fd = connect_server(path);
+  if (fd >= 0) {
+    fprintf(stderr, "gtdialog: a server is already listening on %s\n", path), close(fd);
+    return 1;
+  }
+  unlink(path); // stale
+  if ((fd = unix_socket(path, &addr)) < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+    listen(fd, SOMAXCONN) < 0) {
+    fprintf(stderr, "gtdialog: cannot listen on %s\n", path);
+    return 1;
+  }
+  server_socket = path;
+  signal(SIGINT, stop_server), signal(SIGTERM, stop_server), signal(SIGHUP, stop_server);
+  GIOChannel *ch = g_io_channel_unix_new(fd);
+  g_io_add_watch(ch, G_IO_IN, serve_request, NULL);
+  gtk_main();
+  return 0;
+}
+#endif
+
 #ifndef LIBRARY
 /**
  * Runs gtdialog from the command line and prints its output to stdout.
@@ -2100,14 +4819,38 @@ int help(int argc, char *argv[]) {
  * @param argv The set of command line parameters for the dialog.
  */
 int main(int argc, char *argv[]) {
+#if (GTK && !_WIN32)
+  if (argc == 3 && strcmp(argv[1], "--server") == 0) {
+    const char *path = argv[2];
+    return (gtk_init(&argc, &argv), serve(path));
+  } else if (argc > 3 && strcmp(argv[1], "--client") == 0) {
+    // Forward the dialog to the server, or show it directly if there is no server.
+    int status = -1;
+    if (gtdialog_type(argv[3]) != GTDIALOG_UNKNOWN)
+      status = request_dialog(argv[2], argc - 3, &argv[3]);
+    if (status >= 0) return status;
+    argv[2] = argv[0], argc -= 2, argv += 2;
+  }
+#endif
   if (argc == 1 || strcmp(argv[1], "help") == 0) return help(argc, argv);
-  int type = gtdialog_type(argv[1]);
+  int type = gtdialog_type(argv[1]), i;
   if (type == GTDIALOG_UNKNOWN) return help(argc, argv);
+  for (i = 2; i < argc; i++)
+    if (strcmp(argv[i], "--profile") == 0) profile_start = profile_last = monotonic_time();
 #if GTK
   gtk_init(&argc, &argv);
 #elif CURSES
-  initscr();
+#if !_WIN32
+  // When stdin is not a terminal (e.g. filteredlist items are piped in), read keys from the
+  // controlling terminal instead.
+  FILE *tty = !isatty(0) ? fopen("/dev/tty", "r") : NULL;
+  if (tty)
+    newterm(NULL, stdout, tty);
+  else
+#endif
+    initscr();
 #endif
+  profile_phase("init");
   char *out = gtdialog(type, argc - 2, (const char **)&argv[2]);
 #if CURSES
   endCDK();
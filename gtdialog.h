@@ -63,15 +63,78 @@ void gtdialog_set_parent(GtkWindow *parent);
 #endif
 
 /**
- * Sets the callback function used for progressbar dialogs.
+ * Sets the callback function used for the next progressbar dialog.
+ * Each progressbar dialog keeps the callback it was created with, so other dialogs may be shown
+ * or another callback set while it is running.
+ * The callback is called repeatedly on a separate thread so slow work does not keep the dialog
+ * from responding, and it must not call toolkit functions. (On Windows, curses dialogs call it
+ * themselves.) Only its latest progress is shown, at most once per display frame. When the
+ * progressbar is stopped or closed, the callback is not called again, and the dialog returns once
+ * the callback's current call returns.
  * @param callback Function to call to do some work. It must return either a newly allocated
  *   string of the form "num str\n", where num is integer progress between 0 and 100 and str is
  *   optional progress display text, or it must return `NULL`, signaling work is complete. The
  *   returned string will be freed by the caller.
  * @param data Optional data passed to the callback function.
+ * @see gtdialog_set_progressbar_stop_flag
  */
 void gtdialog_set_progressbar_callback(char *(*f)(void *), void *data);
 
+/**
+ * Sets the flag the next progressbar dialog sets to a non-zero value if it is stopped or closed
+ * before its callback function finishes.
+ * The callback function can poll this flag in order to abandon long-running work early.
+ * @param flag Pointer to the flag, which is set atomically.
+ */
+void gtdialog_set_progressbar_stop_flag(int *flag);
+
+/** A handle for pushing progress to a progressbar dialog. */
+typedef struct GTDialogProgress GTDialogProgress;
+
+/**
+ * Creates and returns a progress handle that the next progressbar dialog shows updates from,
+ * instead of reading them from stdin.
+ * Any number of threads may push updates to the handle at once. Only the latest percentage and
+ * text are shown, at most once per display frame.
+ * The handle must be freed with `gtdialog_progress_free()` once the dialog has returned and no
+ * thread uses it anymore.
+ * @return progress handle
+ */
+GTDialogProgress *gtdialog_progress_new(void);
+
+/**
+ * Pushes a progress update to the given progress handle.
+ * This function may be called from any thread.
+ * @param handle The progress handle.
+ * @param percent Integer progress between 0 and 100, or -1 to keep the current progress.
+ * @param text Progress display text, which is copied and truncated to 255 bytes, or `NULL` to
+ *   keep the current text. Updates do not allocate memory or wait for other threads, so when
+ *   more than 14 threads update text at the same moment, some of those texts are skipped.
+ */
+void gtdialog_progress_update(GTDialogProgress *handle, int percent, const char *text);
+
+/**
+ * Signals that work is complete, closing the progressbar dialog that shows the given progress
+ * handle's updates.
+ * This function may be called from any thread.
+ * @param handle The progress handle.
+ */
+void gtdialog_progress_finish(GTDialogProgress *handle);
+
+/**
+ * Returns whether or not the progressbar dialog that shows the given progress handle's updates
+ * was stopped or closed before work was complete.
+ * This function may be called from any thread.
+ * @param handle The progress handle.
+ */
+int gtdialog_progress_stopped(GTDialogProgress *handle);
+
+/**
+ * Frees the given progress handle.
+ * @param handle The progress handle.
+ */
+void gtdialog_progress_free(GTDialogProgress *handle);
+
 /**
  * Returns the GTDialogType for the given type string.
  * @param type The string dialog type. Acceptable types are "msgbox", "ok-msgbox", "yesno-msgbox",
@@ -93,4 +156,36 @@ GTDialogType gtdialog_type(const char *type);
  */
 char *gtdialog(GTDialogType type, int narg, const char *args[]);
 
+/** A gtdialog shown asynchronously by `gtdialog_async()`. */
+typedef struct GTDialogAsync GTDialogAsync;
+
+/**
+ * Creates and displays a gtdialog of the given type from the given set of parameters without
+ * waiting for it to finish, and passes its result to the given callback function once it does.
+ * In GTK, the dialog is shown and the callback is called from the application's main loop, which
+ * keeps dispatching the application's other events while the dialog is open. Asynchronous dialogs
+ * are not modal, and each dialog's callback is called as soon as that dialog gets a response.
+ * In curses, which has no main loop, the dialog is shown and the callback is called before this
+ * function returns.
+ * @param type The GTDialogType type.
+ * @param narg The number of parameters in *args*.
+ * @param args The set of parameters for the dialog. They are copied.
+ * @param callback Function to call with the dialog's string result, which must be freed when
+ *   finished, and *userdata*. The result is `NULL` if the dialog was cancelled before being shown.
+ * @param userdata Optional data passed to the callback function.
+ * @return handle for `gtdialog_cancel()` that is valid until the callback is called, or `NULL`
+ *   in curses
+ */
+GTDialogAsync *gtdialog_async(GTDialogType type, int narg, const char *args[],
+  void (*callback)(char *result, void *userdata), void *userdata);
+
+/**
+ * Cancels the given asynchronous gtdialog.
+ * If the dialog has not been shown yet, its callback is called with a `NULL` result. Otherwise
+ * the dialog is closed as if the user had closed its window, and its callback is called with
+ * that result. This function does nothing in curses.
+ * @param dialog The handle returned by `gtdialog_async()`.
+ */
+void gtdialog_cancel(GTDialogAsync *dialog);
+
 #endif